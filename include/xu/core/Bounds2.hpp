@@ -92,6 +92,15 @@ struct XU_API Bounds2 {
         return Bounds2<T>(lower - deltaSize, upper + deltaSize);
     }
 
+    // Returns the smallest Bounds2<T> containing both this and other
+    constexpr Bounds2<T> Union(const Bounds2& other) const {
+        return Bounds2<T>(
+            Point2<T>(std::min(lower.x, other.lower.x),
+                std::min(lower.y, other.lower.y)),
+            Point2<T>(std::max(upper.x, other.upper.x),
+                std::max(upper.y, other.upper.y)));
+    }
+
     constexpr Vector2<T> Size() const { return upper - lower; }
 
     constexpr T& Top() { return lower.y; }
@@ -43,6 +43,14 @@ struct XU_API Color {
     std::array<float, 4> Normalized() const {
         return std::array<float, 4>{{r / 255.0f, g / 255.0f, b / 255.0f, a}};
     }
+
+    constexpr bool operator==(Color const& rhs) const {
+        return r == rhs.r && g == rhs.g && b == rhs.b && a == rhs.a;
+    }
+
+    constexpr bool operator!=(Color const& rhs) const {
+        return !(*this == rhs);
+    }
 };
 
 } // namespace xu
\ No newline at end of file
@@ -26,8 +26,11 @@
 #include <xu/core/Point2.hpp>
 #include <xu/core/Vector2.hpp>
 #include <xu/core/Events.hpp>
+#include <xu/core/EventQueue.hpp>
+#include <xu/core/HitTestGrid.hpp>
 #include <xu/core/RenderData.hpp>
 #include <xu/core/Surface.hpp>
+#include <xu/core/TessellationCache.hpp>
 #include <xu/core/WsiInterface.hpp>
 #include <xu/core/InputState.hpp>
 #include <xu/core/Theme.hpp>
@@ -35,7 +38,7 @@
 // Temporary?
 #include <xu/core/Widget.hpp>
 
-#include <queue>
+#include <unordered_map>
 
 namespace xu {
 
@@ -45,22 +48,37 @@ namespace xu {
 enum class InputReception {
     /*!
      * \brief Indicates that events will be dispatched in order of submission
-     * (FIFO) on calling Context::ProcessEvents()
+     * (FIFO) on calling Context::ProcessEvents(). Events may be notified from
+     * any thread.
      */
     Queued,
     /*!
      * \brief Indicates that events will be dispatched immediately as they are
-     * received.
+     * received. Events must then be notified from the thread calling
+     * Context::ProcessEvents().
      */
     Immediate
 };
 
+class WorkerPool;
+
 /*!
  * \brief Core context class of the Xu library.
  */
 class XU_API Context final {
 public:
+    /*!
+     * \brief Default number of events the queue can hold.
+     */
+    static constexpr std::size_t DefaultEventQueueCapacity = 1024;
+
     Context();
+    /*!
+     * \brief Creates a context whose event queue holds at least
+     * eventQueueCapacity events. The queue never grows.
+     */
+    explicit Context(std::size_t eventQueueCapacity);
+    ~Context();
 
     /*!
      * \brief Notifies Xu that a window resize event has occured.
@@ -89,17 +107,81 @@ public:
     void NotifyEvent(CursorButtonEvent const& evt);
 
     /*!
-     * \brief Processes all events until none are left. After this call, the
-     * event queue is empty. \sa [Insert windowing event docs link]
+     * \brief Processes the events that were queued when the call started.
+     * Events posted while processing, from this or other threads, are left for
+     * the next call. \sa [Insert windowing event docs link]
      */
     void ProcessEvents();
 
+    /*!
+     * \brief Changes what happens when an event is notified while the event
+     * queue is full. Defaults to EventOverflowPolicy::DiscardNewest.
+     */
+    void SetEventOverflowPolicy(EventOverflowPolicy policy);
+
+    /*!
+     * \brief Returns the counters of the event queue, e.g. to detect dropped
+     * events.
+     */
+    EventQueueStats GetEventQueueStats() const;
+
     /*!
      * \brief Obtain data necessary to render the UI.
      * \sa [Insert rendering API docs link]
      */
     RenderData const& GetRenderData() const;
 
+    /*!
+     * \brief Returns whether the render data changed during the last call to
+     * ProcessEvents(). If it did not, the previous frame can be presented as
+     * is, and hosts may skip drawing and swapping entirely.
+     * \sa Widget::MarkDirty
+     */
+    bool IsRenderDataDirty() const;
+
+    /*!
+     * \brief Returns how many draw commands the windows painted and how many
+     * are left in GetRenderData() after adjacent ones were merged.
+     * \sa RenderData::MergeDrawCommands
+     */
+    DrawCommandStats GetDrawCommandStats() const;
+
+    /*!
+     * \brief Sets how many worker threads paint and tessellate windows in
+     * parallel during ProcessEvents(). With 0 (the default), all windows are
+     * built on the calling thread. The output does not depend on the thread
+     * count. Widget::Paint() and the theme must be safe to call concurrently
+     * for widgets of different windows when workers are used.
+     */
+    void SetRenderThreadCount(std::size_t count);
+
+    /*!
+     * \brief Selects the vertex attributes generated into the render data.
+     * With VertexFormat::PositionColor, every vertex carries the color of the
+     * draw command it belongs to, so backends can draw neighbouring commands
+     * of different colors in one call. Changing the format rebuilds all
+     * windows. Defaults to VertexFormat::Position.
+     */
+    void SetVertexFormat(VertexFormat format);
+
+    /*!
+     * \brief Returns the vertex format selected with SetVertexFormat().
+     */
+    VertexFormat GetVertexFormat() const;
+
+    /*!
+     * \brief Selects the type of the indices in the render data. With
+     * IndexFormat::UInt16, index uploads are halved; draw commands are split
+     * where a window has too many vertices for 16-bit indices. Changing the
+     * format rebuilds all windows. Defaults to IndexFormat::UInt32.
+     */
+    void SetIndexFormat(IndexFormat format);
+
+    /*!
+     * \brief Returns the index format selected with SetIndexFormat().
+     */
+    IndexFormat GetIndexFormat() const;
+
     /*!
      * \brief Changes the theme that should be given to widgets during
      * rendering.
@@ -115,11 +197,30 @@ public:
      */
     Theme& GetTheme() const;
 
+    /*!
+     * \brief Returns the cache through which widgets and themes should bake
+     * their vector paths, so identical shapes are tessellated once.
+     */
+    TessellationCache& GetTessellationCache();
+
     /*!
      * \brief Select which method must be used for event processing.
      * \sa InputReception
      */
-    InputReception inputReception;
+    InputReception inputReception = InputReception::Queued;
+
+    /*!
+     * \brief When set, ProcessEvents() keeps at most one cursor move, window
+     * move and window resize per window between two cursor button or cursor
+     * enter events, whatever order they arrive in. Cursor move deltas are
+     * accumulated and the last position/size wins. Cursor button and cursor
+     * enter events are never merged, and nothing is merged across them, so
+     * they keep their order relative to the merged events. Neither is
+     * anything merged across a cursor move to another window, so the cursor
+     * ends up in the window it moved to last. Only applies to
+     * InputReception::Queued.
+     */
+    bool coalesceEvents = false;
 
     /*!
      * \brief Should this be private, and should it be const? Pointer to user's
@@ -131,7 +232,18 @@ public:
     // In turn calls the user's window handler for a new window.
     WidgetPtr<Widget> AddWindow(const char* title, ISize2 size);
 
+    /*!
+     * \brief Destroys a window added with AddWindow() along with its widgets,
+     * and calls the user's window handler to destroy the OS window. Does
+     * nothing if no window has the given ID. When called from a widget signal
+     * handler, e.g. a close button, the window is removed once the handlers
+     * run by the current ProcessEvents() call have returned.
+     */
+    void RemoveWindow(WindowID id);
+
 private:
+    friend class Widget;
+
     enum class EventType {
         WindowResize,
         WindowMove,
@@ -149,21 +261,45 @@ private:
             CursorButtonEvent cursorButton;
         } data{WindowResizeEvent{}};
     };
+    void DispatchEvent(Event const& evt);
     void DispatchEvent(WindowResizeEvent const& evt);
     void DispatchEvent(WindowMoveEvent const& evt);
     void DispatchEvent(WindowCursorEnterEvent const& evt);
     void DispatchEvent(CursorMoveEvent const& evt);
     void DispatchEvent(CursorButtonEvent const& evt);
-    std::queue<Event> eventQueue;
+    EventQueue<Event> eventQueue;
+    // See EventQueueStats::unknownWindow.
+    uint64_t unknownWindowEvents = 0;
+    // Events drained in one ProcessEvents() call, when coalescing. Reserved
+    // to the queue capacity so it never reallocates.
+    std::vector<Event> eventBatch;
+
+    // Merges evt into the pending event of the same type and window in
+    // eventBatch[first, end), if any.
+    bool CoalesceEvent(std::size_t first, Event const& evt);
+    static bool CoalesceEvent(Event& into, Event const& evt);
 
     void DoWidgetCallbacks();
+    // Drops all references to a widget that is being destroyed.
+    void ForgetWidget(Widget* widget);
     void BuildRenderData();
-    void PaintWidgetAndChildren(Widget* widget, Surface& surface);
+    // Repaints every window on the next build, e.g. when the output format
+    // changes.
+    void MarkAllWindowsDirty();
+    void PaintWidgetAndChildren(
+        Widget* widget, Surface& surface, std::vector<FBounds2>& damage);
+    void ForgetPaintedWidgetAndChildren(
+        Widget* widget, std::vector<FBounds2>& damage);
     void InitializeWidgetThemeAndChildren(Widget* widget);
+    void InsertWidgetAndChildren(HitTestGrid& grid, Widget* widget);
 
     RenderData renderData;
+    bool renderDataDirty = true;
+    VertexFormat vertexFormat = VertexFormat::Position;
+    IndexFormat indexFormat = IndexFormat::UInt32;
 
     std::unique_ptr<Theme> theme;
+    TessellationCache tessellationCache;
 
     struct WindowData {
         Rect2<int32_t> rect;
@@ -176,14 +312,54 @@ private:
         // ID for the windowing interface
         WindowID windowID;
         Surface surface;
+        // Render data of this window alone, reused until a widget in it is
+        // marked dirty.
+        RenderData renderData;
+        // Set when the whole window must be redrawn, e.g. after a resize.
+        bool fullDamage = true;
+        // Of renderData, as returned by RenderData::MergeDrawCommands().
+        DrawCommandStats drawCommandStats;
+        // Rebuilt whenever the root widget's hitTestDirty flag is set.
+        HitTestGrid hitTestGrid;
+        // Topmost widget under the pointer, as of the last pointer change.
+        Widget* hoveredWidget = nullptr;
+        // Scratch storage for BuildWindowRenderData(), per window so windows
+        // can be built concurrently.
+        std::vector<FBounds2> damage;
         WindowData windowData{};
         std::unique_ptr<Widget> widget;
     };
+    // Kept in the order windows were added in, which is also the order of
+    // the command lists.
     std::vector<RootWidgetNode> rootWidgets;
+    // Windows rebuilt in the current BuildRenderData() call.
+    std::vector<RootWidgetNode*> dirtyWindows;
+    std::unique_ptr<WorkerPool> workerPool;
+
+    // Paints and tessellates one dirty window into its own render data. Only
+    // touches that window, so it may run on a worker thread.
+    void BuildWindowRenderData(RootWidgetNode& window);
+    // Index into rootWidgets of each window.
+    std::unordered_map<WindowID, std::size_t> windowIndices;
+    // Events tend to come in runs for the same window, so the last lookup is
+    // checked before the map.
+    std::size_t lastWindowIndex = 0;
+
+    // Returns nullptr for unknown windows, e.g. events that arrive after
+    // RemoveWindow().
+    RootWidgetNode* FindWindow(WindowID id);
+
+    // Set while DoWidgetCallbacks() runs signal handlers. RemoveWindow() then
+    // only records the window, since the handler's widget is still in use.
+    bool dispatchingCallbacks = false;
+    std::vector<WindowID> pendingWindowRemovals;
 
     // Temporary?
     InputState inputState;
     InputState prevInputState;
+    // Set when the pointer moved or entered/left a window since the last
+    // DoWidgetCallbacks().
+    bool pointerChanged = false;
 
     // Temporary until proper eventing is implemented
     ISize2 windowSize;
@@ -0,0 +1,252 @@
+// MIT License
+//
+// Copyright (c) 2020 Xu Collaborators
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <xu/core/Definitions.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace xu {
+
+/*!
+ * \brief Select what happens when an event is posted to a full queue.
+ */
+enum class EventOverflowPolicy {
+    /*!
+     * \brief The posted event is dropped; queued events are kept.
+     */
+    DiscardNewest,
+    /*!
+     * \brief The oldest queued event is dropped to make room for the posted
+     * one.
+     */
+    DiscardOldest
+};
+
+/*!
+ * \brief Counters of an EventQueue. All values are totals since the queue
+ * was created.
+ */
+struct EventQueueStats {
+    /*!
+     * \brief Number of events that were successfully posted.
+     */
+    uint64_t posted = 0;
+    /*!
+     * \brief Number of events lost because the queue was full.
+     */
+    uint64_t dropped = 0;
+    /*!
+     * \brief Number of events taken out of the queue by the consumer.
+     */
+    uint64_t drained = 0;
+    /*!
+     * \brief Number of events ignored because no window has their window ID,
+     * e.g. because the window was removed while they were queued.
+     * EventQueue::GetStats() leaves this at 0; Context::GetEventQueueStats()
+     * fills it in.
+     */
+    uint64_t unknownWindow = 0;
+};
+
+/*!
+ * \brief Bounded, lock-free FIFO queue. Any number of threads may push
+ * concurrently with one consumer thread popping. Storage is allocated once on
+ * construction, so neither pushing nor popping allocates.
+ *
+ * Each slot carries a sequence number telling whether it is ready to be
+ * written or read, so producers and the consumer only contend on the
+ * position counters.
+ */
+template<typename T>
+class EventQueue final {
+public:
+    /*!
+     * \brief Creates a queue that holds at least the given number of elements.
+     * The capacity is rounded up to a power of two.
+     */
+    explicit EventQueue(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) { size *= 2; }
+
+        cells = std::make_unique<Cell[]>(size);
+        mask = size - 1;
+        for (std::size_t i = 0; i < size; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    EventQueue(EventQueue const&) = delete;
+    EventQueue& operator=(EventQueue const&) = delete;
+
+    /*!
+     * \brief Adds an element to the back of the queue. Safe to call from any
+     * thread. Returns false if the element was dropped.
+     */
+    bool Push(T const& value) {
+        while (!TryPush(value)) {
+            if (overflowPolicy.load(std::memory_order_relaxed)
+                == EventOverflowPolicy::DiscardNewest) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            // Make room by dropping the oldest element, then try again.
+            T discarded;
+            if (TryPop(discarded)) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        posted.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /*!
+     * \brief Removes the element at the front of the queue. Returns false if
+     * the queue is empty. Must only be called from the consumer thread.
+     */
+    bool Pop(T& value) {
+        if (!TryPop(value)) { return false; }
+        drained.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /*!
+     * \brief Returns the number of queued elements. This is only a snapshot
+     * while other threads are pushing.
+     */
+    std::size_t Size() const {
+        std::size_t const tail = dequeuePos.load(std::memory_order_acquire);
+        std::size_t const head = enqueuePos.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+    /*!
+     * \brief Returns the number of elements the queue can hold.
+     */
+    std::size_t Capacity() const { return mask + 1; }
+
+    /*!
+     * \brief Changes what Push() does when the queue is full.
+     */
+    void SetOverflowPolicy(EventOverflowPolicy policy) {
+        overflowPolicy.store(policy, std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief Returns what Push() does when the queue is full.
+     */
+    EventOverflowPolicy GetOverflowPolicy() const {
+        return overflowPolicy.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief Returns the counters of the queue.
+     */
+    EventQueueStats GetStats() const {
+        EventQueueStats stats;
+        stats.posted = posted.load(std::memory_order_relaxed);
+        stats.dropped = dropped.load(std::memory_order_relaxed);
+        stats.drained = drained.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    bool TryPush(T const& value) {
+        std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            std::size_t const sequence
+                = cell->sequence.load(std::memory_order_acquire);
+            auto const diff = static_cast<std::ptrdiff_t>(sequence)
+                - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producers call this too, to implement DiscardOldest, so it must stay
+    // safe with several concurrent callers.
+    bool TryPop(T& value) {
+        std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            std::size_t const sequence
+                = cell->sequence.load(std::memory_order_acquire);
+            auto const diff = static_cast<std::ptrdiff_t>(sequence)
+                - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = cell->value;
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask = 0;
+
+    // Kept on separate cache lines so producers and the consumer do not
+    // invalidate each other's counter.
+    alignas(64) std::atomic<std::size_t> enqueuePos{0};
+    alignas(64) std::atomic<std::size_t> dequeuePos{0};
+
+    alignas(64) std::atomic<uint64_t> posted{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> drained{0};
+    std::atomic<EventOverflowPolicy> overflowPolicy{
+        EventOverflowPolicy::DiscardNewest};
+};
+
+} // namespace xu
@@ -76,8 +76,15 @@ struct XU_API WindowCursorEnterEvent {
 
 struct XU_API CursorMoveEvent {
     /*!
-     * \brief New mouse position in global pixel coordinates.
-     *        Relative to the top left of the primary display.
+     * \brief ID of the window the cursor moved in. If left at the default,
+     * the cursor is taken to have moved in the window it was last in, or in the
+     * only window if there is just one.
+     */
+    WindowID id{};
+
+    /*!
+     * \brief New mouse position in pixel coordinates.
+     *        Relative to the top left of the window.
      */
     IPoint2 position;
 
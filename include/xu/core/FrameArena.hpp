@@ -0,0 +1,123 @@
+// MIT License
+//
+// Copyright (c) 2020 Xu Collaborators
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <xu/core/Definitions.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace xu {
+
+/*!
+ * \brief Contiguous range of elements stored elsewhere, e.g. in a FrameArena.
+ */
+template<typename T>
+struct ArenaSpan {
+    ArenaSpan() = default;
+    ArenaSpan(T* data, std::size_t size) : data{data}, size{size} {}
+    // Allows ArenaSpan<T> to ArenaSpan<T const> conversions.
+    template<typename U,
+        typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+    ArenaSpan(ArenaSpan<U> const& other) : data{other.data}, size{other.size} {}
+
+    T* data = nullptr;
+    std::size_t size = 0;
+
+    T* begin() const { return data; }
+    T* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+    T& operator[](std::size_t i) const { return data[i]; }
+};
+
+/*!
+ * \brief Linear allocator for data that lives until the next Reset(), such as
+ * the paint nodes of one frame. Allocating is a pointer bump, and Reset()
+ * releases everything at once while keeping the memory for the next frame, so
+ * a steady state frame does not touch the heap.
+ *
+ * Only trivially copyable and destructible types can be stored, since
+ * destructors are never run.
+ */
+class XU_API FrameArena {
+public:
+    FrameArena() = default;
+    FrameArena(FrameArena const&) = delete;
+    FrameArena& operator=(FrameArena const&) = delete;
+    FrameArena(FrameArena&&) = default;
+    FrameArena& operator=(FrameArena&&) = default;
+
+    /*!
+     * \brief Returns uninitialized storage for count objects of type T.
+     */
+    template<typename T>
+    ArenaSpan<T> Allocate(std::size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>
+            && std::is_trivially_destructible_v<T>);
+        static_assert(alignof(T) <= alignof(std::max_align_t));
+        if (count == 0) { return {}; }
+        void* data = AllocateBytes(count * sizeof(T), alignof(T));
+        return {static_cast<T*>(data), count};
+    }
+
+    /*!
+     * \brief Copies count objects into the arena.
+     */
+    template<typename T>
+    ArenaSpan<T> Copy(T const* source, std::size_t count) {
+        ArenaSpan<T> span = Allocate<T>(count);
+        std::uninitialized_copy(source, source + count, span.data);
+        return span;
+    }
+
+    /*!
+     * \brief Releases all allocations. Memory is kept for reuse; if the last
+     * frame needed several blocks, they are replaced by a single block large
+     * enough for all of them.
+     */
+    void Reset();
+
+    /*!
+     * \brief Returns the number of bytes allocated since the last Reset().
+     */
+    std::size_t BytesUsed() const { return bytesUsed; }
+
+private:
+    static constexpr std::size_t MinBlockSize = 16 * 1024;
+
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size = 0;
+    };
+
+    void* AllocateBytes(std::size_t size, std::size_t alignment);
+
+    std::vector<Block> blocks;
+    std::size_t currentBlock = 0;
+    std::size_t offset = 0;
+    std::size_t bytesUsed = 0;
+};
+
+} // namespace xu
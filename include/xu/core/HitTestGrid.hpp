@@ -0,0 +1,85 @@
+// MIT License
+//
+// Copyright (c) 2020 Xu Collaborators
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <xu/core/Bounds2.hpp>
+#include <xu/core/Definitions.hpp>
+#include <xu/core/Point2.hpp>
+
+#include <vector>
+
+namespace xu {
+
+class Widget;
+
+/*!
+ * \brief Uniform grid over the geometry of the widgets of one window. Used to
+ * find the widget under the pointer without testing every widget.
+ */
+class XU_API HitTestGrid {
+public:
+    /*!
+     * \brief Removes all widgets from the grid.
+     */
+    void Clear();
+
+    /*!
+     * \brief Adds a widget to the grid. Widgets inserted later are considered
+     * to be on top of widgets inserted earlier, so they should be inserted in
+     * painting order.
+     */
+    void Insert(Widget* widget);
+
+    /*!
+     * \brief Distributes the inserted widgets into grid cells. Must be called
+     * after inserting and before querying.
+     */
+    void Build();
+
+    /*!
+     * \brief Returns the topmost widget whose Widget::PointerHit accepts the
+     * pointer, or nullptr if there is none. Only widgets whose geometry
+     * contains the pointer are tested.
+     */
+    Widget* Query(FPoint2 const& pointer) const;
+
+private:
+    struct Entry {
+        Widget* widget;
+        FBounds2 bounds;
+    };
+
+    std::vector<Entry> entries;
+    // Entries of cell i are cellEntries[cellStarts[i]..cellStarts[i + 1]], in
+    // insertion order.
+    std::vector<uint32_t> cellStarts;
+    std::vector<uint32_t> cellEntries;
+
+    FBounds2 bounds;
+    FVector2 cellSize;
+    int32_t columns = 0;
+    int32_t rows = 0;
+};
+
+} // namespace xu
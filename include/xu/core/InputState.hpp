@@ -30,6 +30,10 @@ namespace xu {
 
 class XU_API InputState {
 public:
+    /*!
+     * \brief Window the cursor position is relative to.
+     */
+    WindowID cursorWindow{};
     IVector2 cursorPosition;
     IVector2 cursorPositionDelta;
 
@@ -134,7 +134,7 @@ public:
     /*!
      * \brief Returns the hidden state of this object. That is to say; should
      * its rectangle be considered in the layout.
-     * \sa Widget::hidden
+     * \sa Widget::Hidden
      */
     bool Hidden() const;
 
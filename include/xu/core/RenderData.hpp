@@ -41,6 +41,54 @@ struct XU_API Vertex {
     FVector2 position;
 };
 
+/*!
+ * \brief Color of a single vertex, as 8-bit RGBA components in that byte order.
+ * \sa VertexFormat::PositionColor
+ */
+struct XU_API VertexColor {
+    static VertexColor FromColor(Color const& color);
+
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+};
+
+/*!
+ * \brief Selects which vertex attributes are generated.
+ * \sa Context::SetVertexFormat
+ */
+enum class VertexFormat {
+    /*!
+     * \brief Only RenderData::vertices. Each draw command is drawn in its
+     * CmdDrawTriangles::color.
+     */
+    Position,
+    /*!
+     * \brief RenderData::colors holds the color of each vertex as well, so
+     * draws of different colors can be submitted in a single draw call.
+     * CmdDrawTriangles::color is still set, but only holds the color of the
+     * first shape a merged command draws.
+     */
+    PositionColor
+};
+
+/*!
+ * \brief Selects the type of the indices handed to backends.
+ * \sa Context::SetIndexFormat
+ */
+enum class IndexFormat {
+    /*!
+     * \brief 32-bit indices, stored in RenderData::indices.
+     */
+    UInt32,
+    /*!
+     * \brief 16-bit indices, stored in RenderData::indices16. Draw commands
+     * whose vertices span more than 65536 vertices are split.
+     */
+    UInt16
+};
+
 /*!
  * \brief Used to describe which kind of draw command is active in the command
  * union \sa [Insert rendering API doc link]
@@ -155,6 +203,23 @@ struct XU_API DrawCommand {
     } data{0, 0, 0, xu::Color::White()}; // Default initialize to a default drawTriangles. This is necessary to make DrawCommand default constructible
 };
 
+/*!
+ * \brief Number of draw commands of one or more command lists, before and
+ * after RenderData::MergeDrawCommands().
+ */
+struct XU_API DrawCommandStats {
+    /*!
+     * \brief Number of DrawTriangles commands that were generated.
+     */
+    std::size_t generated = 0;
+    /*!
+     * \brief Number of DrawTriangles commands left after merging, and
+     * splitting for IndexFormat::UInt16, i.e. the number of draw calls a
+     * backend issues.
+     */
+    std::size_t submitted = 0;
+};
+
 /*!
  * \brief Stores a list of drawing commands. Each OS window gets its own command
  * list.
@@ -225,6 +290,14 @@ public:
     Iterator Begin() const;
     Iterator End() const;
 
+    /*! \brief Regions of the window that changed since the previous frame, in
+     * the same normalized coordinate space as the vertices. Everything outside
+     * of them is identical to the previous frame, so backends which preserve
+     * the previous frame may scissor drawing and present only these regions.
+     * Empty if nothing in the window changed.
+     */
+    std::vector<FRect2> const& DamageRects() const;
+
     /*! \brief Push a new command into the command list.
      *  \param command Command to push into the list
      */
@@ -240,8 +313,10 @@ public:
 
 private:
     friend class Context;
+    friend class RenderData;
 
     std::vector<DrawCommand> commands;
+    std::vector<FRect2> damageRects;
 };
 
 /*!
@@ -253,7 +328,7 @@ public:
     // We will build one command list for each OS window so they can be executed
     // in parallel for people who build a vulkan renderer. This also avoids the
     // hassle of having CommandList::Iterator track the current window to draw
-    // to.
+    // to. Command lists are in the order the windows were added in.
     std::vector<CommandList> cmdLists;
     /*!
      * \brief List of all vertices used by all command lists. These positions
@@ -261,20 +336,52 @@ public:
      * window.
      */
     std::vector<Vertex> vertices;
+    /*!
+     * \brief Color of each vertex, parallel to vertices, as a second vertex
+     * stream. Only filled with VertexFormat::PositionColor; empty otherwise.
+     */
+    std::vector<VertexColor> colors;
+    /*!
+     * \brief Vertex attributes present in this render data.
+     */
+    VertexFormat vertexFormat = VertexFormat::Position;
+    /*!
+     * \brief List of all indices used by all command lists. Indices are
+     * relative to the CmdDrawTriangles::vertexOffset of the command using them.
+     * Empty with IndexFormat::UInt16 once NarrowIndices() ran.
+     */
     std::vector<uint32_t> indices;
+    /*!
+     * \brief Same as indices, but 16-bit. Only filled with IndexFormat::UInt16.
+     */
+    std::vector<uint16_t> indices16;
+    /*!
+     * \brief Which of indices and indices16 the draw commands refer to.
+     */
+    IndexFormat indexFormat = IndexFormat::UInt32;
 
     /*!
-     * \brief Clears all render data stored.
+     * \brief Clears all render data stored. The vertex and index formats are
+     * kept.
      */
     void Clear();
 
     /*!
-     * \brief Adds a single vertex to the vertex list and returns its index
+     * \brief Appends the command lists, vertices and indices of another
+     * RenderData, rebasing the vertex and index offsets of its draw commands.
+     * Both must have the same vertex and index formats.
+     */
+    void Append(RenderData const& other);
+
+    /*!
+     * \brief Adds a single vertex to the vertex list and returns its index. The
+     * color is only stored with VertexFormat::PositionColor.
      */
-    size_t PushVertex(Vertex vertex);
+    size_t PushVertex(Vertex vertex, Color const& color = Color::White());
 
     /*!
-     * \brief Adds a single index to the index list.
+     * \brief Adds a single index to the index list. Indices are always pushed
+     * as 32-bit, see NarrowIndices().
      */
     void PushIndex(uint32_t index);
 
@@ -294,6 +401,26 @@ public:
 
     void PushGeometry(CommandList& cmdList, std::vector<Vertex> const& verts,
         std::vector<uint32_t> const& idx, Color const& color);
+
+    /*!
+     * \brief Merges adjacent DrawTriangles commands of a command list whose
+     * indices are contiguous and which can be drawn in one call: those of the
+     * same color, or any with VertexFormat::PositionColor. Layer commands are
+     * never crossed. The indices of merged commands are rebased onto the
+     * vertexOffset of the command they are merged into.
+     * \return The number of commands before and after merging.
+     */
+    DrawCommandStats MergeDrawCommands(CommandList& cmdList);
+
+    /*!
+     * \brief Moves indices into indices16 for IndexFormat::UInt16. Draw
+     * commands are split, by whole triangles, wherever their indices would not
+     * fit in 16 bits relative to their vertexOffset. Triangles whose own
+     * vertices lie further apart than that are drawn from copies of their
+     * vertices, appended to vertices (and colors).
+     * \return The number of DrawTriangles commands afterwards.
+     */
+    std::size_t NarrowIndices();
 };
 
 } // namespace xu
\ No newline at end of file
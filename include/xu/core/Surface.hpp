@@ -24,12 +24,22 @@
 
 #include <xu/core/Color.hpp>
 #include <xu/core/Definitions.hpp>
+#include <xu/core/FrameArena.hpp>
 #include <xu/core/RenderData.hpp>
 #include <xu/core/Size2.hpp>
 #include <xu/core/VectorPath.hpp>
 
 namespace xu {
 
+/*!
+ * \brief Transform applied to painted geometry; each point p becomes
+ * p * scale + offset.
+ */
+struct XU_API PaintTransform {
+    FVector2 offset{0.f, 0.f};
+    FVector2 scale{1.f, 1.f};
+};
+
 /*!
  * \brief Represents a surface for widgets to paint their visual representation
  * on.
@@ -37,7 +47,29 @@ namespace xu {
 class XU_API Surface {
 public:
     // TODO: More paint options for coloring, etc
+    /*!
+     * \brief Paints a copy of the geometry. Prefer the SharedBakedVectorPath
+     * overload for geometry that is painted more than once.
+     */
     void Paint(BakedVectorPath const& geometry, Color const& color);
+    /*!
+     * \brief Paints shared geometry by reference. Only the reference and the
+     * transform are recorded; vertices are transformed once, while the render
+     * data is generated.
+     */
+    void Paint(SharedBakedVectorPath const& geometry, Color const& color,
+        PaintTransform const& transform = {});
+    /*!
+     * \brief Strokes count points as one polyline of the given width, without
+     * building a VectorPath. The points are copied; the stroke is expanded
+     * straight into the render data when it is generated.
+     *
+     * Corners are mitered, with miters clamped to twice the width, and the
+     * ends have butt caps. Meant for polylines with many points that change
+     * every frame, such as charts.
+     */
+    void PaintPolyline(FPoint2 const* points, std::size_t count, float width,
+        Color const& color, PaintTransform const& transform = {});
 
     void Clear();
 
@@ -47,12 +79,33 @@ private:
     void GenerateGeometry(
         RenderData& renderData, CommandList& cmdList, FSize2 windowSize);
 
+    // Bounds of everything painted since paint node firstNode. Returns false if
+    // nothing was painted.
+    bool PaintedBounds(std::size_t firstNode, FBounds2& bounds) const;
+
+    // Geometry lives either in the arena or in a shared path, so painting a
+    // path does not allocate once the arena and paintNodes have grown to the
+    // size of a frame.
     struct PaintNode {
-        BakedVectorPath path;
+        // Vertices, or the points of a polyline.
+        ArenaSpan<FPoint2 const> vertices;
+        // Empty for polylines.
+        ArenaSpan<uint32_t const> indices;
+        // Keeps shared geometry alive; null for geometry in the arena.
+        SharedBakedVectorPath shared;
+        PaintTransform transform;
         Color color;
+        // Nonzero for polylines, which are stroked in GenerateGeometry().
+        float strokeWidth = 0.f;
+
+        // Sizes of the geometry the node generates.
+        std::size_t NumVertices() const;
+        std::size_t NumIndices() const;
     };
 
     std::vector<PaintNode> paintNodes;
+    // Reset by Clear(), i.e. whenever the surface is repainted.
+    FrameArena arena;
 };
 
 } // namespace xu
\ No newline at end of file
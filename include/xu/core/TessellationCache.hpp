@@ -0,0 +1,150 @@
+// MIT License
+//
+// Copyright (c) 2020 Xu Collaborators
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <xu/core/Definitions.hpp>
+#include <xu/core/VectorPath.hpp>
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace xu {
+
+/*!
+ * \brief Counters of a TessellationCache.
+ */
+struct XU_API TessellationCacheStats {
+    /*!
+     * \brief Number of bakes answered from the cache.
+     */
+    uint64_t hits = 0;
+    /*!
+     * \brief Number of bakes that had to tessellate the path.
+     */
+    uint64_t misses = 0;
+    /*!
+     * \brief Number of entries dropped to stay within the capacity.
+     */
+    uint64_t evictions = 0;
+    /*!
+     * \brief Number of entries currently cached.
+     */
+    std::size_t entries = 0;
+};
+
+/*!
+ * \brief Cache of baked vector paths, keyed on the content of the path and
+ * the bake parameters. Identical shapes, e.g. the outlines of many buttons of
+ * the same size, are then tessellated once and shared. The least recently used
+ * entries are evicted once the capacity is reached.
+ *
+ * All functions may be called from any thread.
+ */
+class XU_API TessellationCache {
+public:
+    static constexpr std::size_t DefaultCapacity = 256;
+
+    explicit TessellationCache(std::size_t capacity = DefaultCapacity);
+
+    TessellationCache(TessellationCache const&) = delete;
+    TessellationCache& operator=(TessellationCache const&) = delete;
+
+    /*!
+     * \brief Same as VectorPath::BakeFill(), but returns the cached result if
+     * the path was baked with the same parameters before.
+     */
+    SharedBakedVectorPath BakeFill(VectorPath const& path, double quality);
+
+    /*!
+     * \brief Same as VectorPath::BakeStroke(), but returns the cached result
+     * if the path was baked with the same parameters before.
+     */
+    SharedBakedVectorPath BakeStroke(VectorPath const& path, double quality,
+        float strokeWidth, LineCap cap = LineCap::Butt,
+        LineJoin join = LineJoin::Miter, float miterLimit = 1.f);
+
+    /*!
+     * \brief Changes the maximum number of entries, evicting entries if
+     * needed. A capacity of 0 disables caching.
+     */
+    void SetCapacity(std::size_t capacity);
+    std::size_t Capacity() const;
+
+    /*!
+     * \brief Drops all entries. Paths handed out before stay valid.
+     */
+    void Clear();
+
+    TessellationCacheStats GetStats() const;
+
+private:
+    // Everything a bake depends on. The events are not owned, so a lookup can
+    // be done without copying the path.
+    struct KeyView {
+        bool stroke;
+        double quality;
+        float strokeWidth;
+        LineCap cap;
+        LineJoin join;
+        float miterLimit;
+        FillRule fillRule;
+        FPoint2 start;
+        VectorPathEvent const* events;
+        std::size_t numEvents;
+        std::size_t hash;
+    };
+    struct KeyHash {
+        std::size_t operator()(KeyView const& key) const { return key.hash; }
+    };
+    struct KeyEqual {
+        bool operator()(KeyView const& lhs, KeyView const& rhs) const;
+    };
+
+    struct Entry {
+        std::vector<VectorPathEvent> events;
+        KeyView key;
+        SharedBakedVectorPath path;
+    };
+    // Most recently used first.
+    using EntryList = std::list<Entry>;
+
+    static KeyView MakeKey(VectorPath const& path, bool stroke, double quality,
+        float strokeWidth, LineCap cap, LineJoin join, float miterLimit);
+    static std::size_t HashKey(KeyView const& key);
+
+    SharedBakedVectorPath Find(KeyView const& key);
+    SharedBakedVectorPath Insert(
+        KeyView const& key, SharedBakedVectorPath path);
+    void EvictToCapacity();
+
+    mutable std::mutex mutex;
+    EntryList entries;
+    std::unordered_map<KeyView, EntryList::iterator, KeyHash, KeyEqual> index;
+    std::size_t capacity;
+    TessellationCacheStats stats;
+};
+
+} // namespace xu
@@ -33,7 +33,7 @@ namespace xu {
 class Widget;
 
 struct XU_API PaintInfo {
-    std::vector<BakedVectorPath> paths;
+    std::vector<SharedBakedVectorPath> paths;
 };
 
 struct XU_API Parameters {
@@ -27,11 +27,19 @@
 #include <xu/core/Point2.hpp>
 
 #include <array>
+#include <memory>
 #include <vector>
 
 namespace xu {
 
-enum class XU_API VectorPathEventType { Line, Quadratic, Cubic, Arc };
+enum class XU_API VectorPathEventType {
+    Line,
+    Quadratic,
+    Cubic,
+    Arc,
+    Move,
+    Close
+};
 
 struct XU_API VectorPathEvent {
     static VectorPathEvent Line(FPoint2 to);
@@ -39,6 +47,15 @@ struct XU_API VectorPathEvent {
     static VectorPathEvent Cubic(FPoint2 to, FPoint2 x0, FPoint2 x1);
     static VectorPathEvent Arc(
         FPoint2 center, float radius, float startAngle, float endAngle);
+    /*!
+     * \brief Ends the current contour and starts a new one at to.
+     */
+    static VectorPathEvent Move(FPoint2 to);
+    /*!
+     * \brief Closes the current contour back to its first point. Drawing
+     * after this starts a new contour from that same point.
+     */
+    static VectorPathEvent Close();
 
     VectorPathEventType type;
     union XU_API Params {
@@ -60,11 +77,33 @@ struct XU_API VectorPathEvent {
             float startAngle;
             float endAngle;
         } arc;
+        struct XU_API Move {
+            FPoint2 to;
+        } move;
     } params{Params::Line{FPoint2{0.0f, 0.0f}}};
 };
 
-enum class LineCap { Butt, Square };
-enum class LineJoin { Bevel, Miter };
+enum class LineCap { Butt, Square, Round };
+enum class LineJoin { Bevel, Miter, Round };
+
+/*!
+ * \brief Decides which regions of a path with several contours are filled.
+ *
+ * Contours are classified as a whole by testing their first point against the
+ * other contours, so contours should not intersect each other or themselves.
+ */
+enum class FillRule {
+    /*!
+     * \brief Fills regions with a nonzero winding number; a contour cuts a hole
+     * only if it winds opposite to the contour around it.
+     */
+    NonZero,
+    /*!
+     * \brief Fills regions enclosed by an odd number of contours, so every
+     * nested contour cuts a hole regardless of its direction.
+     */
+    EvenOdd
+};
 
 struct XU_API BakedVectorPath {
     BakedVectorPath WithOffset(FVector2 offset) const;
@@ -76,6 +115,12 @@ struct XU_API BakedVectorPath {
     std::vector<uint32_t> indices;
 };
 
+/*!
+ * \brief Immutable baked geometry that can be painted any number of times
+ * without being copied. \sa Surface::Paint
+ */
+using SharedBakedVectorPath = std::shared_ptr<BakedVectorPath const>;
+
 struct XU_API VectorPath {
     static VectorPath Rectangle(FSize2 size);
     static VectorPath RoundRectangle(
@@ -90,8 +135,27 @@ struct XU_API VectorPath {
         LineCap cap = LineCap::Butt, LineJoin join = LineJoin::Miter,
         float miterLimit = 1.f) const;
 
+    /*!
+     * \brief Same as BakeFill(double), but bakes into out, reusing the memory
+     * it already holds.
+     */
+    void BakeFill(BakedVectorPath& out, double quality) const;
+    /*!
+     * \brief Same as BakeStroke(double, float, LineCap, LineJoin, float), but
+     * bakes into out, using scratch for the flattened path. Reusing both across
+     * calls avoids allocating when rebaking.
+     */
+    void BakeStroke(BakedVectorPath& out, std::vector<FPoint2>& scratch,
+        double quality, float strokeWidth, LineCap cap = LineCap::Butt,
+        LineJoin join = LineJoin::Miter, float miterLimit = 1.f) const;
+
     FPoint2 start{0.f, 0.f};
     std::vector<VectorPathEvent> events;
+    /*!
+     * \brief Only affects BakeFill(); all contours are triangulated together
+     * with holes cut according to this rule.
+     */
+    FillRule fillRule = FillRule::NonZero;
 };
 
 } // namespace xu
\ No newline at end of file
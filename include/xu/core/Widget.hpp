@@ -108,6 +108,26 @@ public:
      */
     virtual FRect2 Geometry() const final;
 
+    /*!
+     * \brief Changes whether this widget is hidden or not. This propagates to
+     * child widgets.
+     */
+    virtual void SetHidden(bool hidden) final;
+
+    /*!
+     * \brief Returns whether this widget is hidden or not.
+     * \sa SetHidden
+     */
+    virtual bool Hidden() const final;
+
+    /*!
+     * \brief Schedules this widget to be repainted. Widgets must call this
+     * whenever state that affects Widget::Paint changes; until then, the render
+     * data from the last paint is reused.
+     * \sa Context::IsRenderDataDirty
+     */
+    virtual void MarkDirty() final;
+
     /*!
      * \brief Obtain a pointer to the parent of this widget. If there is no
      * parent, nullptr is returned.
@@ -196,22 +216,42 @@ public:
      */
     Signal<> sigBeforeDestruction;
 
+    /*!
+     * \brief Signal emitted when the pointer starts hovering this widget.
+     */
     Signal<> sigOnHoverEnter;
+    /*!
+     * \brief Signal emitted when the pointer stops hovering this widget.
+     */
     Signal<> sigOnHoverExit;
+    /*!
+     * \brief Signal emitted when a cursor button is pressed while hovering
+     * this widget.
+     */
     Signal<CursorButton> sigOnClick;
-
     /*!
-     * \brief Toggle to indicate whether this widget is hidden or not. This
-     * propagates to child widgets.
+     * \brief Signal emitted when a cursor button is released while hovering
+     * this widget.
      */
-    bool hidden;
+    Signal<CursorButton> sigOnRelease;
 
 private:
     friend class LayoutItem;
     friend class Layout;
+    friend class Context;
 
     explicit Widget(Widget* parent, Context* context);
 
+    // Flags the hit-test index of the window this widget is in as stale.
+    void InvalidateHitTest();
+
+    bool hidden;
+    bool dirty;           //!< This widget must be repainted.
+    bool descendantDirty; //!< A widget below this one must be repainted.
+    bool painted;         //!< Whether paintedBounds is valid.
+    FBounds2 paintedBounds; //!< Bounds of what was painted last, for damage.
+    bool hitTestDirty; //!< Root widgets only: the hit-test grid is stale.
+
     FRect2 geometry;
     std::unique_ptr<Layout>
         ownedLayout;      //!< Layout this widget owns (possibly nullptr).
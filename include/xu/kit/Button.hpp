@@ -44,10 +44,14 @@ protected:
     void OnHoverEnter();
     void OnHoverExit();
     void OnClick(CursorButton button);
+    void OnRelease(CursorButton button);
+
+    void SetCurrentColor(Color const& color);
 
     UniqueSlot<&Button::OnHoverEnter> slotHoverEnter;
     UniqueSlot<&Button::OnHoverExit> slotHoverExit;
     UniqueSlot<&Button::OnClick> slotOnClick;
+    UniqueSlot<&Button::OnRelease> slotOnRelease;
 
     PaintInfo paintInfo;
     Color currentColor;
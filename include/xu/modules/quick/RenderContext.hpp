@@ -36,8 +36,12 @@ public:
 	void RenderDrawData(xu::RenderData const& renderData);
 private:
 	unsigned int shaderProgram;
+    // Used for VertexFormat::PositionColor
+    unsigned int colorShaderProgram;
     unsigned int vao;
     unsigned int vbo;
+    // Per-vertex colors
+    unsigned int cbo;
     unsigned int ebo;
 
     unsigned int CreateShader(const char* vtxSource, const char* fragSource);
@@ -45,6 +45,8 @@ public:
     WindowID GetMainWindow();
 
     void PollEvents();
+    // Like PollEvents(), but sleeps until at least one event arrives.
+    void WaitEvents();
     bool ShouldClose(WindowID id) const;
     void SwapBuffers(WindowID id);
 
@@ -23,11 +23,26 @@
 #include <xu/core/Context.hpp>
 #include <xu/kit/BasicTheme.hpp>
 
+#include "WorkerPool.hpp"
+
+#include <algorithm>
 #include <iostream> // For debugging.
 
 namespace xu {
 
-Context::Context() : theme{std::make_unique<BasicTheme>()} {}
+Context::Context() : Context{DefaultEventQueueCapacity} {}
+
+Context::Context(std::size_t eventQueueCapacity) :
+    eventQueue{eventQueueCapacity}, theme{std::make_unique<BasicTheme>()} {
+    eventBatch.reserve(eventQueue.Capacity());
+}
+
+Context::~Context() {
+    // Widgets call back into the context while being destroyed, so tear them
+    // down while rootWidgets is still in a valid state.
+    auto windows = std::move(rootWidgets);
+    windows.clear();
+}
 
 void Context::NotifyEvent(WindowResizeEvent const& evt) {
     switch (inputReception) {
@@ -35,7 +50,7 @@ void Context::NotifyEvent(WindowResizeEvent const& evt) {
             Event event;
             event.type = EventType::WindowResize;
             event.data.windowResize = evt;
-            eventQueue.push(event);
+            eventQueue.Push(event);
             break;
         }
         case InputReception::Immediate: DispatchEvent(evt); break;
@@ -48,7 +63,7 @@ void Context::NotifyEvent(WindowMoveEvent const& evt) {
             Event event;
             event.type = EventType::WindowMove;
             event.data.windowMove = evt;
-            eventQueue.push(event);
+            eventQueue.Push(event);
             break;
         }
         case InputReception::Immediate: DispatchEvent(evt); break;
@@ -61,7 +76,7 @@ void Context::NotifyEvent(WindowCursorEnterEvent const& evt) {
             Event event;
             event.type = EventType::WindowCursorEnter;
             event.data.windowCursorEnter = evt;
-            eventQueue.push(event);
+            eventQueue.Push(event);
             break;
         }
         case InputReception::Immediate: DispatchEvent(evt); break;
@@ -74,7 +89,7 @@ void Context::NotifyEvent(CursorMoveEvent const& evt) {
             Event event;
             event.type = EventType::CursorMove;
             event.data.cursorMove = evt;
-            eventQueue.push(event);
+            eventQueue.Push(event);
             break;
         }
         case InputReception::Immediate: DispatchEvent(evt); break;
@@ -87,7 +102,7 @@ void Context::NotifyEvent(CursorButtonEvent const& evt) {
             Event event;
             event.type = EventType::CursorButton;
             event.data.cursorButton = evt;
-            eventQueue.push(event);
+            eventQueue.Push(event);
             break;
         }
         case InputReception::Immediate: DispatchEvent(evt); break;
@@ -95,31 +110,39 @@ void Context::NotifyEvent(CursorButtonEvent const& evt) {
 }
 
 void Context::ProcessEvents() {
-    prevInputState = inputState;
-
     if (inputReception == InputReception::Queued) {
-        while (!eventQueue.empty()) {
-            auto const& evt = eventQueue.front();
-
-            switch (evt.type) {
-                case EventType::WindowMove:
-                    DispatchEvent(evt.data.windowMove);
-                    break;
-                case EventType::WindowResize:
-                    DispatchEvent(evt.data.windowResize);
-                    break;
-                case EventType::WindowCursorEnter:
-                    DispatchEvent(evt.data.windowCursorEnter);
-                    break;
-                case EventType::CursorMove:
-                    DispatchEvent(evt.data.cursorMove);
-                    break;
-                case EventType::CursorButton:
-                    DispatchEvent(evt.data.cursorButton);
-                    break;
+        // Only drain what is queued now, so producers that keep posting
+        // cannot stall the frame.
+        std::size_t const count = eventQueue.Size();
+        Event evt;
+        if (coalesceEvents) {
+            eventBatch.clear();
+            // Events after the last barrier; only those may be merged into.
+            std::size_t pending = 0;
+            // Whether eventBatch[pending, end) holds a cursor move.
+            bool pendingMove = false;
+            for (std::size_t i = 0; i < count && eventQueue.Pop(evt); ++i) {
+                if (CoalesceEvent(pending, evt)) { continue; }
+                // A move that did not merge is for another window. Merging
+                // later moves past it would reorder the windows, and the
+                // cursor would end up in the wrong one.
+                if (evt.type == EventType::CursorMove && pendingMove) {
+                    pending = eventBatch.size();
+                }
+                eventBatch.push_back(evt);
+                if (evt.type == EventType::CursorButton
+                    || evt.type == EventType::WindowCursorEnter) {
+                    pending = eventBatch.size();
+                    pendingMove = false;
+                } else if (evt.type == EventType::CursorMove) {
+                    pendingMove = true;
+                }
+            }
+            for (auto const& batched : eventBatch) { DispatchEvent(batched); }
+        } else {
+            for (std::size_t i = 0; i < count && eventQueue.Pop(evt); ++i) {
+                DispatchEvent(evt);
             }
-
-            eventQueue.pop();
         }
     }
 
@@ -129,8 +152,56 @@ void Context::ProcessEvents() {
 
 RenderData const& Context::GetRenderData() const { return renderData; }
 
+bool Context::IsRenderDataDirty() const { return renderDataDirty; }
+
+DrawCommandStats Context::GetDrawCommandStats() const {
+    DrawCommandStats stats;
+    for (auto const& window : rootWidgets) {
+        stats.generated += window.drawCommandStats.generated;
+        stats.submitted += window.drawCommandStats.submitted;
+    }
+    return stats;
+}
+
+void Context::SetRenderThreadCount(std::size_t count) {
+    if (count == (workerPool ? workerPool->ThreadCount() : 0)) { return; }
+    workerPool = count > 0 ? std::make_unique<WorkerPool>(count) : nullptr;
+}
+
+void Context::SetVertexFormat(VertexFormat format) {
+    if (format == vertexFormat) { return; }
+
+    vertexFormat = format;
+    MarkAllWindowsDirty();
+}
+
+VertexFormat Context::GetVertexFormat() const { return vertexFormat; }
+
+void Context::SetIndexFormat(IndexFormat format) {
+    if (format == indexFormat) { return; }
+
+    indexFormat = format;
+    MarkAllWindowsDirty();
+}
+
+IndexFormat Context::GetIndexFormat() const { return indexFormat; }
+
+void Context::SetEventOverflowPolicy(EventOverflowPolicy policy) {
+    eventQueue.SetOverflowPolicy(policy);
+}
+
+EventQueueStats Context::GetEventQueueStats() const {
+    EventQueueStats stats = eventQueue.GetStats();
+    stats.unknownWindow = unknownWindowEvents;
+    return stats;
+}
+
 Theme& Context::GetTheme() const { return *theme.get(); }
 
+TessellationCache& Context::GetTessellationCache() {
+    return tessellationCache;
+}
+
 struct TestWindow : public Widget {
     TestWindow(Context& context) : Widget(context) {}
 
@@ -146,46 +217,165 @@ WidgetPtr<Widget> Context::AddWindow(const char* title, ISize2 size) {
     newNode.windowData.rect = newWindowResult.rect;
     newNode.widget = std::unique_ptr<Widget>(new TestWindow(*this));
 
+    windowIndices[newNode.windowID] = rootWidgets.size();
     rootWidgets.push_back(std::move(newNode));
 
     return WidgetPtr<Widget>(rootWidgets.back().widget.get());
 }
 
+void Context::RemoveWindow(WindowID id) {
+    auto const it = windowIndices.find(id);
+    if (it == windowIndices.end()) { return; }
+
+    if (dispatchingCallbacks) {
+        if (std::find(pendingWindowRemovals.begin(),
+                pendingWindowRemovals.end(), id)
+            == pendingWindowRemovals.end()) {
+            pendingWindowRemovals.push_back(id);
+        }
+        return;
+    }
+
+    std::size_t const index = it->second;
+    windowIndices.erase(it);
+
+    // Destroy the widgets only once the window bookkeeping is consistent
+    // again, since widget destructors call back into the context.
+    RootWidgetNode node = std::move(rootWidgets[index]);
+    rootWidgets.erase(rootWidgets.begin() + index);
+    for (std::size_t i = index; i < rootWidgets.size(); ++i) {
+        windowIndices[rootWidgets[i].windowID] = i;
+    }
+    lastWindowIndex = 0;
+
+    node.widget.reset();
+    wsiInterface->DestroyWindow(id);
+}
+
+Context::RootWidgetNode* Context::FindWindow(WindowID id) {
+    if (lastWindowIndex < rootWidgets.size()
+        && rootWidgets[lastWindowIndex].windowID == id) {
+        return &rootWidgets[lastWindowIndex];
+    }
+
+    auto const it = windowIndices.find(id);
+    if (it == windowIndices.end()) { return nullptr; }
+
+    lastWindowIndex = it->second;
+    return &rootWidgets[it->second];
+}
+
+bool Context::CoalesceEvent(std::size_t first, Event const& evt) {
+    // Holds at most one event per type and window, so this stays short.
+    for (std::size_t i = first; i < eventBatch.size(); ++i) {
+        if (CoalesceEvent(eventBatch[i], evt)) { return true; }
+    }
+    return false;
+}
+
+bool Context::CoalesceEvent(Event& into, Event const& evt) {
+    if (into.type != evt.type) { return false; }
+
+    switch (evt.type) {
+        case EventType::WindowResize:
+            if (into.data.windowResize.id != evt.data.windowResize.id) {
+                return false;
+            }
+            into.data.windowResize.size = evt.data.windowResize.size;
+            return true;
+        case EventType::WindowMove:
+            if (into.data.windowMove.id != evt.data.windowMove.id) {
+                return false;
+            }
+            into.data.windowMove.position = evt.data.windowMove.position;
+            return true;
+        case EventType::CursorMove:
+            if (into.data.cursorMove.id != evt.data.cursorMove.id) {
+                return false;
+            }
+            into.data.cursorMove.position = evt.data.cursorMove.position;
+            into.data.cursorMove.positionDelta
+                += evt.data.cursorMove.positionDelta;
+            return true;
+        default: return false;
+    }
+}
+
+void Context::DispatchEvent(Event const& evt) {
+    switch (evt.type) {
+        case EventType::WindowMove: DispatchEvent(evt.data.windowMove); break;
+        case EventType::WindowResize:
+            DispatchEvent(evt.data.windowResize);
+            break;
+        case EventType::WindowCursorEnter:
+            DispatchEvent(evt.data.windowCursorEnter);
+            break;
+        case EventType::CursorMove: DispatchEvent(evt.data.cursorMove); break;
+        case EventType::CursorButton:
+            DispatchEvent(evt.data.cursorButton);
+            break;
+    }
+}
+
 void Context::DispatchEvent(WindowResizeEvent const& evt) {
-    auto& rootWidgetNode = *std::find_if(rootWidgets.begin(), rootWidgets.end(),
-        [&evt](RootWidgetNode const& node) -> bool {
-            return evt.id == node.windowID;
-        });
+    RootWidgetNode* window = FindWindow(evt.id);
+    if (!window) {
+        ++unknownWindowEvents;
+        return;
+    }
 
-    rootWidgetNode.windowData.rect.size = evt.size;
+    window->windowData.rect.size = evt.size;
+    // Vertices are normalized to the window size.
+    window->widget->MarkDirty();
+    window->fullDamage = true;
 
     windowSize = evt.size;
 }
 
 void Context::DispatchEvent(WindowMoveEvent const& evt) {
-    auto& rootWidgetNode = *std::find_if(rootWidgets.begin(), rootWidgets.end(),
-        [&evt](RootWidgetNode const& node) -> bool {
-            return evt.id == node.windowID;
-        });
+    RootWidgetNode* window = FindWindow(evt.id);
+    if (!window) {
+        ++unknownWindowEvents;
+        return;
+    }
 
-    rootWidgetNode.windowData.rect.origin = evt.position;
+    window->windowData.rect.origin = evt.position;
 }
 
 void Context::DispatchEvent(WindowCursorEnterEvent const& evt) {
-    auto& rootWidgetNode = *std::find_if(rootWidgets.begin(), rootWidgets.end(),
-        [&evt](RootWidgetNode const& node) -> bool {
-            return evt.id == node.windowID;
-        });
+    RootWidgetNode* window = FindWindow(evt.id);
+    if (!window) {
+        ++unknownWindowEvents;
+        return;
+    }
 
-    rootWidgetNode.windowData.cursorIsInside = evt.entered;
+    window->windowData.cursorIsInside = evt.entered;
+    pointerChanged = true;
 }
 
 void Context::DispatchEvent(CursorMoveEvent const& evt) {
+    RootWidgetNode* window = nullptr;
+    if (evt.id != WindowID{}) {
+        window = FindWindow(evt.id);
+    } else {
+        // The WSI did not say which window; keep using the current one.
+        window = FindWindow(inputState.cursorWindow);
+        if (!window && rootWidgets.size() == 1) { window = &rootWidgets[0]; }
+    }
+    // E.g. the window was removed while the event was queued.
+    if (!window) {
+        ++unknownWindowEvents;
+        return;
+    }
+
+    inputState.cursorWindow = window->windowID;
     inputState.cursorPosition = evt.position;
     inputState.cursorPositionDelta = evt.positionDelta;
 
-    // Possibly move down the widget hierarchy
-    // and invoke some cursor hover events?
+    // Moving inside a window implies the cursor entered it, even if the WSI
+    // did not report it (yet).
+    window->windowData.cursorIsInside = true;
+    pointerChanged = true;
 }
 
 void Context::DispatchEvent(CursorButtonEvent const& evt) {
@@ -199,63 +389,250 @@ void Context::DoWidgetCallbacks() {
     FPoint2 pointer;
     pointer.x = inputState.cursorPosition.x;
     pointer.y = inputState.cursorPosition.y;
-    // TODO: This does not handle widgets that are on top of each other, and it
-    // also does not respect multiple windows correctly
-    auto process = [this, &pointer](Widget* widget, auto self) -> void {
-        if (widget->PointerHit(pointer)) {
-            widget->sigOnHoverEnter();
-            for (int i = 0; i < static_cast<int>(CursorButton::COUNT); ++i) {
-                if (inputState.GetCursorButton(static_cast<CursorButton>(i))) {
-                    widget->sigOnClick(static_cast<CursorButton>(i));
-                }
+
+    dispatchingCallbacks = true;
+    // Handlers may add windows, so rootWidgets is indexed and the node looked
+    // up again after running them.
+    for (std::size_t w = 0; w < rootWidgets.size(); ++w) {
+        RootWidgetNode& window = rootWidgets[w];
+        Widget* root = window.widget.get();
+        bool const hitTestRebuilt = root->hitTestDirty;
+        if (hitTestRebuilt) {
+            window.hitTestGrid.Clear();
+            InsertWidgetAndChildren(window.hitTestGrid, root);
+            window.hitTestGrid.Build();
+            root->hitTestDirty = false;
+        }
+
+        // The hovered widget can only change if the pointer or the widgets
+        // under it did; otherwise the cached one is still correct.
+        if (pointerChanged || hitTestRebuilt) {
+            // Pointer coordinates are relative to the window the cursor is
+            // in, so other windows must not be tested against them.
+            Widget* const hovered = window.windowData.cursorIsInside
+                    && inputState.cursorWindow == window.windowID
+                ? window.hitTestGrid.Query(pointer)
+                : nullptr;
+
+            if (hovered != window.hoveredWidget) {
+                // Update the cache first; handlers may destroy widgets.
+                Widget* const prevHovered = window.hoveredWidget;
+                window.hoveredWidget = hovered;
+                if (prevHovered) { prevHovered->sigOnHoverExit(); }
+                Widget* const entered = rootWidgets[w].hoveredWidget;
+                if (entered) { entered->sigOnHoverEnter(); }
             }
-        } else { // Handle hover exit
-            FPoint2 prevPointer;
-            prevPointer.x = prevInputState.cursorPosition.x;
-            prevPointer.y = prevInputState.cursorPosition.y;
-            if (widget->PointerHit(prevPointer)) { widget->sigOnHoverExit(); }
         }
 
-        for (size_t i = 0; i < widget->NumChildren(); ++i) {
-            self(widget->GetChild(i), self);
+        for (int i = 0; i < static_cast<int>(CursorButton::COUNT); ++i) {
+            auto const button = static_cast<CursorButton>(i);
+            bool const down = inputState.GetCursorButton(button);
+            Widget* const hovered = rootWidgets[w].hoveredWidget;
+            if (!hovered || down == prevInputState.GetCursorButton(button)) {
+                continue;
+            }
+
+            if (down) {
+                hovered->sigOnClick(static_cast<CursorButton>(i));
+            } else {
+                hovered->sigOnRelease(static_cast<CursorButton>(i));
+            }
         }
-    };
+    }
+
+    dispatchingCallbacks = false;
+
+    for (WindowID const id : pendingWindowRemovals) { RemoveWindow(id); }
+    pendingWindowRemovals.clear();
 
-    for (auto& widgetNode : rootWidgets) {
-        process(widgetNode.widget.get(), process);
+    prevInputState = inputState;
+    pointerChanged = false;
+}
+
+void Context::ForgetWidget(Widget* widget) {
+    for (auto& window : rootWidgets) {
+        if (window.hoveredWidget == widget) { window.hoveredWidget = nullptr; }
+    }
+}
+
+// Past this many damage rectangles per window, they are merged into one.
+static constexpr std::size_t MaxDamageRects = 8;
+
+static void AddDamage(std::vector<FBounds2>& damage, FBounds2 bounds) {
+    // Grow overlapping rectangles instead of adding new ones, so backends get
+    // a small set of disjoint regions.
+    for (std::size_t i = 0; i < damage.size();) {
+        if (damage[i].Overlaps(bounds)) {
+            bounds = bounds.Union(damage[i]);
+            damage[i] = damage.back();
+            damage.pop_back();
+            i = 0;
+        } else {
+            ++i;
+        }
+    }
+    damage.push_back(bounds);
+
+    if (damage.size() > MaxDamageRects) {
+        for (auto const& rect : damage) { bounds = bounds.Union(rect); }
+        damage.clear();
+        damage.push_back(bounds);
+    }
+}
+
+static void NormalizeDamage(std::vector<FBounds2> const& damage,
+    FSize2 windowSize, std::vector<FRect2>& damageRects) {
+    damageRects.clear();
+    for (auto bounds : damage) {
+        bounds.lower = bounds.lower / windowSize;
+        bounds.upper = bounds.upper / windowSize;
+        bounds.lower.x = std::clamp(bounds.lower.x, 0.f, 1.f);
+        bounds.lower.y = std::clamp(bounds.lower.y, 0.f, 1.f);
+        bounds.upper.x = std::clamp(bounds.upper.x, 0.f, 1.f);
+        bounds.upper.y = std::clamp(bounds.upper.y, 0.f, 1.f);
+        if (bounds.Size().x > 0.f && bounds.Size().y > 0.f) {
+            damageRects.push_back(FRect2{bounds});
+        }
     }
 }
 
 void Context::BuildRenderData() {
-    renderData.Clear();
+    // Windows have been added or removed since the last build.
+    renderDataDirty = renderData.cmdLists.size() != rootWidgets.size();
+
+    dirtyWindows.clear();
+    for (auto& window : rootWidgets) {
+        Widget* root = window.widget.get();
+        if (!root->dirty && !root->descendantDirty) {
+            if (!window.renderData.cmdLists.empty()) {
+                window.renderData.cmdLists[0].damageRects.clear();
+            }
+            continue;
+        }
+        dirtyWindows.push_back(&window);
+    }
+
+    if (workerPool && dirtyWindows.size() > 1) {
+        workerPool->ParallelFor(dirtyWindows.size(),
+            [this](std::size_t i) { BuildWindowRenderData(*dirtyWindows[i]); });
+    } else {
+        for (RootWidgetNode* window : dirtyWindows) {
+            BuildWindowRenderData(*window);
+        }
+    }
+    renderDataDirty = renderDataDirty || !dirtyWindows.empty();
 
-    renderData.cmdLists.resize(rootWidgets.size());
+    if (!renderDataDirty) {
+        for (auto& cmdList : renderData.cmdLists) {
+            cmdList.damageRects.clear();
+        }
+        return;
+    }
 
-    for (size_t i = 0; i < rootWidgets.size(); i++) {
-        RootWidgetNode& window = rootWidgets[i];
-        CommandList& cmdList = renderData.cmdLists[i];
+    // Stitched in window order, so the result does not depend on which
+    // window finished first.
+    renderData.Clear();
+    renderData.vertexFormat = vertexFormat;
+    renderData.indexFormat = indexFormat;
+    for (auto const& window : rootWidgets) {
+        renderData.Append(window.renderData);
+    }
+}
 
-        window.surface.Clear();
-        PaintWidgetAndChildren(window.widget.get(), window.surface);
+void Context::MarkAllWindowsDirty() {
+    for (auto& window : rootWidgets) {
+        window.widget->MarkDirty();
+        window.fullDamage = true;
+    }
+}
 
-        window.surface.GenerateGeometry(renderData, cmdList,
-            FSize2{(float)window.windowData.rect.size.x,
-                (float)window.windowData.rect.size.y});
+void Context::BuildWindowRenderData(RootWidgetNode& window) {
+    window.renderData.Clear();
+    window.renderData.vertexFormat = vertexFormat;
+    window.renderData.indexFormat = indexFormat;
+    window.renderData.cmdLists.resize(1);
+
+    window.damage.clear();
+    window.surface.Clear();
+    PaintWidgetAndChildren(window.widget.get(), window.surface, window.damage);
+
+    FSize2 const windowSize{(float)window.windowData.rect.size.x,
+        (float)window.windowData.rect.size.y};
+    if (window.fullDamage) {
+        window.damage.clear();
+        window.damage.push_back(FBounds2{{0.f, 0.f}, windowSize});
+        window.fullDamage = false;
+    }
+    NormalizeDamage(
+        window.damage, windowSize, window.renderData.cmdLists[0].damageRects);
+
+    window.surface.GenerateGeometry(
+        window.renderData, window.renderData.cmdLists[0], windowSize);
+    window.drawCommandStats = window.renderData.MergeDrawCommands(
+        window.renderData.cmdLists[0]);
+    if (indexFormat == IndexFormat::UInt16) {
+        window.drawCommandStats.submitted = window.renderData.NarrowIndices();
     }
 }
 
-void Context::PaintWidgetAndChildren(Widget* widget, Surface& surface) {
-    if (widget->hidden) { return; }
+void Context::PaintWidgetAndChildren(
+    Widget* widget, Surface& surface, std::vector<FBounds2>& damage) {
+    bool const dirty = widget->dirty;
+    widget->dirty = false;
+    widget->descendantDirty = false;
+
+    if (widget->hidden) {
+        // The subtree only has to be visited once, when it becomes hidden.
+        if (dirty) { ForgetPaintedWidgetAndChildren(widget, damage); }
+        return;
+    }
 
+    std::size_t const firstNode = surface.paintNodes.size();
     widget->Paint(surface, *theme.get());
 
+    // Clean widgets paint exactly what they painted last time, so only dirty
+    // and newly shown widgets contribute damage.
+    if (dirty || !widget->painted) {
+        if (widget->painted) { AddDamage(damage, widget->paintedBounds); }
+        widget->painted
+            = surface.PaintedBounds(firstNode, widget->paintedBounds);
+        if (widget->painted) { AddDamage(damage, widget->paintedBounds); }
+    }
+
+    for (size_t child = 0; child < widget->NumChildren(); ++child) {
+        PaintWidgetAndChildren(widget->GetChild(child), surface, damage);
+    }
+}
+
+void Context::ForgetPaintedWidgetAndChildren(
+    Widget* widget, std::vector<FBounds2>& damage) {
+    widget->dirty = false;
+    widget->descendantDirty = false;
+
+    if (widget->painted) {
+        AddDamage(damage, widget->paintedBounds);
+        widget->painted = false;
+    }
+
+    for (size_t child = 0; child < widget->NumChildren(); ++child) {
+        ForgetPaintedWidgetAndChildren(widget->GetChild(child), damage);
+    }
+}
+
+void Context::InsertWidgetAndChildren(HitTestGrid& grid, Widget* widget) {
+    if (widget->hidden) { return; }
+
+    // Children are painted on top of their parent, so they are inserted after
+    // it.
+    grid.Insert(widget);
     for (size_t child = 0; child < widget->NumChildren(); ++child) {
-        PaintWidgetAndChildren(widget->GetChild(child), surface);
+        InsertWidgetAndChildren(grid, widget->GetChild(child));
     }
 }
 
 void Context::InitializeWidgetThemeAndChildren(Widget* widget) {
     widget->InitializeTheme(*theme.get());
+    widget->MarkDirty();
     for (size_t child = 0; child < widget->NumChildren(); ++child) {
         InitializeWidgetThemeAndChildren(widget->GetChild(child));
     }
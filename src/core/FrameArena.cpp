@@ -0,0 +1,68 @@
+// MIT License
+//
+// Copyright (c) 2020 Xu Collaborators
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <xu/core/FrameArena.hpp>
+
+#include <algorithm>
+
+namespace xu {
+
+void FrameArena::Reset() {
+    if (blocks.size() > 1) {
+        std::size_t total = 0;
+        for (auto const& block : blocks) { total += block.size; }
+
+        blocks.clear();
+        Block block;
+        block.data = std::unique_ptr<unsigned char[]>(new unsigned char[total]);
+        block.size = total;
+        blocks.push_back(std::move(block));
+    }
+
+    currentBlock = 0;
+    offset = 0;
+    bytesUsed = 0;
+}
+
+void* FrameArena::AllocateBytes(std::size_t size, std::size_t alignment) {
+    for (; currentBlock < blocks.size(); ++currentBlock, offset = 0) {
+        Block& block = blocks[currentBlock];
+        std::size_t const start = (offset + alignment - 1) & ~(alignment - 1);
+        if (start + size <= block.size) {
+            offset = start + size;
+            bytesUsed += size;
+            return block.data.get() + start;
+        }
+    }
+
+    // Out of blocks; grow geometrically so a frame needs few of them.
+    std::size_t const lastSize = blocks.empty() ? 0 : blocks.back().size;
+    Block block;
+    block.size = std::max({MinBlockSize, lastSize * 2, size + alignment});
+    block.data = std::unique_ptr<unsigned char[]>(new unsigned char[block.size]);
+    blocks.push_back(std::move(block));
+    currentBlock = blocks.size() - 1;
+    offset = 0;
+    return AllocateBytes(size, alignment);
+}
+
+} // namespace xu
@@ -0,0 +1,141 @@
+// MIT License
+//
+// Copyright (c) 2020 Xu Collaborators
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <xu/core/HitTestGrid.hpp>
+#include <xu/core/Widget.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace xu {
+
+// Upper bound on the amount of columns and rows, so that a few far away
+// widgets cannot blow up the cell count.
+static constexpr int32_t MaxGridSize = 128;
+
+static bool Contains(FBounds2 const& bounds, FPoint2 const& point) {
+    return point.x >= bounds.lower.x && point.y >= bounds.lower.y
+        && point.x <= bounds.upper.x && point.y <= bounds.upper.y;
+}
+
+void HitTestGrid::Clear() {
+    entries.clear();
+    cellStarts.clear();
+    cellEntries.clear();
+    columns = 0;
+    rows = 0;
+}
+
+void HitTestGrid::Insert(Widget* widget) {
+    entries.push_back(Entry{widget, widget->Geometry().Bounds()});
+}
+
+void HitTestGrid::Build() {
+    cellStarts.clear();
+    cellEntries.clear();
+    columns = 0;
+    rows = 0;
+
+    if (entries.empty()) { return; }
+
+    bounds = entries.front().bounds;
+    for (auto const& entry : entries) { bounds = bounds.Union(entry.bounds); }
+
+    // Aim for about one widget per cell.
+    FSize2 const size = bounds.Size();
+    float const cellArea = (size.x * size.y) / entries.size();
+    float const side = std::max(std::sqrt(cellArea), 1.f);
+    columns = std::clamp(
+        static_cast<int32_t>(std::ceil(size.x / side)), 1, MaxGridSize);
+    rows = std::clamp(
+        static_cast<int32_t>(std::ceil(size.y / side)), 1, MaxGridSize);
+    cellSize = FVector2{std::max(size.x / columns, 1.f),
+        std::max(size.y / rows, 1.f)};
+
+    auto cellRange = [this](FBounds2 const& b, int32_t& c0, int32_t& r0,
+                         int32_t& c1, int32_t& r1) {
+        c0 = std::clamp(static_cast<int32_t>((b.lower.x - bounds.lower.x)
+                            / cellSize.x),
+            0, columns - 1);
+        r0 = std::clamp(static_cast<int32_t>((b.lower.y - bounds.lower.y)
+                            / cellSize.y),
+            0, rows - 1);
+        c1 = std::clamp(static_cast<int32_t>((b.upper.x - bounds.lower.x)
+                            / cellSize.x),
+            0, columns - 1);
+        r1 = std::clamp(static_cast<int32_t>((b.upper.y - bounds.lower.y)
+                            / cellSize.y),
+            0, rows - 1);
+    };
+
+    // Counting sort of the entries into the cells they overlap.
+    cellStarts.assign(columns * rows + 1, 0);
+    for (auto const& entry : entries) {
+        int32_t c0, r0, c1, r1;
+        cellRange(entry.bounds, c0, r0, c1, r1);
+        for (int32_t r = r0; r <= r1; ++r) {
+            for (int32_t c = c0; c <= c1; ++c) {
+                ++cellStarts[r * columns + c + 1];
+            }
+        }
+    }
+    for (std::size_t i = 1; i < cellStarts.size(); ++i) {
+        cellStarts[i] += cellStarts[i - 1];
+    }
+
+    cellEntries.resize(cellStarts.back());
+    std::vector<uint32_t> fill(cellStarts.begin(), cellStarts.end() - 1);
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        int32_t c0, r0, c1, r1;
+        cellRange(entries[i].bounds, c0, r0, c1, r1);
+        for (int32_t r = r0; r <= r1; ++r) {
+            for (int32_t c = c0; c <= c1; ++c) {
+                cellEntries[fill[r * columns + c]++] = i;
+            }
+        }
+    }
+}
+
+Widget* HitTestGrid::Query(FPoint2 const& pointer) const {
+    if (columns == 0 || !Contains(bounds, pointer)) { return nullptr; }
+
+    int32_t const c = std::min(
+        static_cast<int32_t>((pointer.x - bounds.lower.x) / cellSize.x),
+        columns - 1);
+    int32_t const r = std::min(
+        static_cast<int32_t>((pointer.y - bounds.lower.y) / cellSize.y),
+        rows - 1);
+    std::size_t const cell = r * columns + c;
+
+    // Walk the cell back to front so the topmost widget wins.
+    for (uint32_t i = cellStarts[cell + 1]; i > cellStarts[cell]; --i) {
+        Entry const& entry = entries[cellEntries[i - 1]];
+        if (Contains(entry.bounds, pointer)
+            && entry.widget->PointerHit(pointer)) {
+            return entry.widget;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace xu
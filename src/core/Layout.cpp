@@ -103,10 +103,16 @@ void LayoutItem::Apply() {
         SizeValue(minSize.y, maxSize.y, hint.y, vertHint)};
 
     switch (type) {
-        case Type::Widget:
-            std::get<0>(item)->geometry.size = size;
-            std::get<0>(item)->geometry.origin = position;
+        case Type::Widget: {
+            Widget* widget = std::get<0>(item);
+            FRect2 const geometry{position, size};
+            if (widget->geometry != geometry) {
+                widget->geometry = geometry;
+                widget->MarkDirty();
+                widget->InvalidateHitTest();
+            }
             break;
+        }
         case Type::Layout:
             std::get<1>(item)->geometry.size = size;
             std::get<1>(item)->geometry.origin = position;
@@ -22,10 +22,19 @@
 
 #include <xu/core/RenderData.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
 
 namespace xu {
 
+VertexColor VertexColor::FromColor(Color const& color) {
+    auto const alpha = std::lround(std::clamp(color.a, 0.f, 1.f) * 255.f);
+    return VertexColor{color.r, color.g, color.b, static_cast<uint8_t>(alpha)};
+}
+
 CommandList::Iterator::Iterator(UnderlyingType it, size_t layer) :
     it(it),
     currentLayer(layer) {}
@@ -114,6 +123,10 @@ CommandList::Iterator CommandList::End() const {
     return Iterator(commands.end());
 }
 
+std::vector<FRect2> const& CommandList::DamageRects() const {
+    return damageRects;
+}
+
 void CommandList::PushCommand(CmdDrawTriangles const& command) {
     DrawCommand cmd;
     cmd.data.drawTriangles = command;
@@ -138,10 +151,42 @@ void CommandList::PushCommand(CmdMergeLayer const& command) {
 void RenderData::Clear() {
     cmdLists.clear();
     vertices.clear();
+    colors.clear();
     indices.clear();
+    indices16.clear();
+}
+
+void RenderData::Append(RenderData const& other) {
+    size_t const baseIndex = indexFormat == IndexFormat::UInt16
+                                 ? indices16.size()
+                                 : indices.size();
+    size_t const baseVertex = vertices.size();
+
+    assert(vertexFormat == other.vertexFormat
+           && "Appended render data must have the same vertex format");
+    assert(indexFormat == other.indexFormat
+           && "Appended render data must have the same index format");
+    vertices.insert(
+        vertices.end(), other.vertices.begin(), other.vertices.end());
+    colors.insert(colors.end(), other.colors.begin(), other.colors.end());
+    indices.insert(indices.end(), other.indices.begin(), other.indices.end());
+    indices16.insert(
+        indices16.end(), other.indices16.begin(), other.indices16.end());
+
+    for (auto const& otherCmdList : other.cmdLists) {
+        CommandList& cmdList = cmdLists.emplace_back(otherCmdList);
+        for (auto& cmd : cmdList.commands) {
+            if (cmd.type != DrawCommandType::DrawTriangles) { continue; }
+            cmd.data.drawTriangles.vertexOffset += baseVertex;
+            cmd.data.drawTriangles.indexOffset += baseIndex;
+        }
+    }
 }
 
-size_t RenderData::PushVertex(Vertex vertex) {
+size_t RenderData::PushVertex(Vertex vertex, Color const& color) {
+    if (vertexFormat == VertexFormat::PositionColor) {
+        colors.push_back(VertexColor::FromColor(color));
+    }
     vertices.push_back(vertex);
     return vertices.size() - 1;
 }
@@ -163,16 +208,17 @@ void RenderData::PushQuad(CommandList& cmdList, FRect2 quad) {
     size_t const topRightIndex = PushVertex({tr});
 
     // A quad needs 2 triangles, so 6 indices. We will create these in CCW order
-    // since this is the most commonly used vertex winding order.
+    // since this is the most commonly used vertex winding order. Indices are
+    // relative to the vertex offset of the draw command.
 
     // First triangle
-    PushIndex(bottomLeftIndex);
-    PushIndex(bottomRightIndex);
-    PushIndex(topRightIndex);
+    PushIndex(bottomLeftIndex - baseVertex);
+    PushIndex(bottomRightIndex - baseVertex);
+    PushIndex(topRightIndex - baseVertex);
     // Second triangle
-    PushIndex(bottomLeftIndex);
-    PushIndex(topRightIndex);
-    PushIndex(topLeftIndex);
+    PushIndex(bottomLeftIndex - baseVertex);
+    PushIndex(topRightIndex - baseVertex);
+    PushIndex(topLeftIndex - baseVertex);
 
     // Create the draw command
     CmdDrawTriangles command;
@@ -193,6 +239,9 @@ void RenderData::PushGeometry(CommandList& cmdList, std::vector<Vertex> const& v
     size_t const baseVertex = vertices.size();
 
     vertices.insert(vertices.end(), verts.begin(), verts.end());
+    if (vertexFormat == VertexFormat::PositionColor) {
+        colors.resize(vertices.size(), VertexColor::FromColor(color));
+    }
     indices.insert(indices.end(), idx.begin(), idx.end());
 
     CmdDrawTriangles command;
@@ -203,4 +252,157 @@ void RenderData::PushGeometry(CommandList& cmdList, std::vector<Vertex> const& v
     cmdList.PushCommand(command);
 }
 
-} // namespace xu
\ No newline at end of file
+DrawCommandStats RenderData::MergeDrawCommands(CommandList& cmdList) {
+    DrawCommandStats stats;
+    bool const perVertexColor = vertexFormat == VertexFormat::PositionColor;
+
+    // Compacted in place; `merged` is one past the last command kept.
+    auto& commands = cmdList.commands;
+    std::size_t merged = 0;
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+        DrawCommand const& cmd = commands[i];
+        if (cmd.type == DrawCommandType::DrawTriangles) {
+            ++stats.generated;
+            DrawCommand* prev = merged > 0 ? &commands[merged - 1] : nullptr;
+            if (prev && prev->type == DrawCommandType::DrawTriangles) {
+                CmdDrawTriangles& into = prev->data.drawTriangles;
+                CmdDrawTriangles const& from = cmd.data.drawTriangles;
+                if (into.indexOffset + into.numIndices == from.indexOffset
+                    && into.vertexOffset <= from.vertexOffset
+                    && (perVertexColor || into.color == from.color)) {
+                    auto const rebase
+                        = static_cast<uint32_t>(from.vertexOffset
+                                                - into.vertexOffset);
+                    if (rebase != 0) {
+                        auto const first = indices.begin() + from.indexOffset;
+                        for (auto it = first; it != first + from.numIndices;
+                             ++it) {
+                            *it += rebase;
+                        }
+                    }
+                    into.numIndices += from.numIndices;
+                    continue;
+                }
+            }
+            ++stats.submitted;
+        }
+        if (merged != i) { commands[merged] = cmd; }
+        ++merged;
+    }
+    commands.resize(merged);
+
+    return stats;
+}
+
+std::size_t RenderData::NarrowIndices() {
+    assert(indexFormat == IndexFormat::UInt16
+           && "NarrowIndices() requires IndexFormat::UInt16");
+    constexpr uint32_t maxIndex = std::numeric_limits<uint16_t>::max();
+    bool const perVertexColor = vertexFormat == VertexFormat::PositionColor;
+
+    std::size_t numDraws = 0;
+    indices16.clear();
+    indices16.reserve(indices.size());
+    std::vector<DrawCommand> commands;
+    // Original vertex (relative to the command) to copied vertex.
+    std::unordered_map<uint32_t, uint16_t> remap;
+    for (auto& cmdList : cmdLists) {
+        commands.clear();
+        commands.reserve(cmdList.commands.size());
+        for (auto const& cmd : cmdList.commands) {
+            if (cmd.type != DrawCommandType::DrawTriangles) {
+                commands.push_back(cmd);
+                continue;
+            }
+
+            CmdDrawTriangles const& from = cmd.data.drawTriangles;
+            uint32_t const* const idx = indices.data() + from.indexOffset;
+            auto const isWide = [idx](std::size_t first, std::size_t last) {
+                auto const [low, high]
+                    = std::minmax_element(idx + first, idx + last);
+                return *high - *low > maxIndex;
+            };
+
+            std::size_t begin = 0;
+            while (begin < from.numIndices) {
+                CmdDrawTriangles part = from;
+                part.indexOffset = indices16.size();
+
+                // Take whole triangles for as long as the range of vertices
+                // they use fits in 16 bits.
+                uint32_t low = std::numeric_limits<uint32_t>::max();
+                uint32_t high = 0;
+                std::size_t end = begin;
+                while (end < from.numIndices) {
+                    std::size_t const next
+                        = std::min(end + 3, std::size_t{from.numIndices});
+                    uint32_t triLow = low;
+                    uint32_t triHigh = high;
+                    for (std::size_t i = end; i < next; ++i) {
+                        triLow = std::min(triLow, idx[i]);
+                        triHigh = std::max(triHigh, idx[i]);
+                    }
+                    if (triHigh - triLow > maxIndex) { break; }
+                    low = triLow;
+                    high = triHigh;
+                    end = next;
+                }
+
+                if (end != begin) {
+                    // Only rebase when needed, so unsplit commands keep their
+                    // vertexOffset.
+                    uint32_t const base = high > maxIndex ? low : 0;
+                    part.vertexOffset += base;
+                    for (std::size_t i = begin; i < end; ++i) {
+                        indices16.push_back(
+                            static_cast<uint16_t>(idx[i] - base));
+                    }
+                } else {
+                    // The triangle alone spans too many vertices, e.g. the
+                    // seam of a long closed stroke or a large fan. It and the
+                    // wide triangles after it get copies of their vertices at
+                    // the end of the vertex list, which are indexed instead.
+                    part.vertexOffset = vertices.size();
+                    remap.clear();
+                    while (end < from.numIndices) {
+                        std::size_t const next
+                            = std::min(end + 3, std::size_t{from.numIndices});
+                        if ((end != begin && !isWide(end, next))
+                            || remap.size() + (next - end) > maxIndex + 1) {
+                            break;
+                        }
+                        for (std::size_t i = end; i < next; ++i) {
+                            auto const [it, added] = remap.try_emplace(
+                                idx[i], static_cast<uint16_t>(remap.size()));
+                            if (added) {
+                                std::size_t const vertex
+                                    = from.vertexOffset + idx[i];
+                                Vertex const copy = vertices[vertex];
+                                vertices.push_back(copy);
+                                if (perVertexColor) {
+                                    VertexColor const color = colors[vertex];
+                                    colors.push_back(color);
+                                }
+                            }
+                            indices16.push_back(it->second);
+                        }
+                        end = next;
+                    }
+                }
+                part.numIndices = end - begin;
+
+                DrawCommand& out = commands.emplace_back();
+                out.type = DrawCommandType::DrawTriangles;
+                out.data.drawTriangles = part;
+                ++numDraws;
+                begin = end;
+            }
+        }
+        cmdList.commands.swap(commands);
+    }
+    indices.clear();
+
+    return numDraws;
+}
+
+} // namespace xu
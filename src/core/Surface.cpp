@@ -24,30 +24,138 @@
 
 #include "Tessellation.hpp"
 
+#include <algorithm>
+
 namespace xu {
 
+// Polyline miters are clamped to this many times half the stroke width.
+static constexpr float PolylineMiterLimit = 4.f;
+
 void Surface::Paint(BakedVectorPath const& geometry, Color const& color) {
-    paintNodes.push_back(PaintNode{geometry, color});
+    PaintNode node;
+    node.vertices
+        = arena.Copy(geometry.vertices.data(), geometry.vertices.size());
+    node.indices = arena.Copy(geometry.indices.data(), geometry.indices.size());
+    node.color = color;
+    paintNodes.push_back(node);
+}
+
+void Surface::Paint(SharedBakedVectorPath const& geometry, Color const& color,
+    PaintTransform const& transform) {
+    XU_ASSERT(geometry);
+    PaintNode node;
+    node.vertices = {geometry->vertices.data(), geometry->vertices.size()};
+    node.indices = {geometry->indices.data(), geometry->indices.size()};
+    node.shared = geometry;
+    node.transform = transform;
+    node.color = color;
+    paintNodes.push_back(std::move(node));
 }
 
-void Surface::Clear() { paintNodes.clear(); }
+void Surface::PaintPolyline(FPoint2 const* points, std::size_t count,
+    float width, Color const& color, PaintTransform const& transform) {
+    if (count < 2 || width <= 0.f) { return; }
+
+    PaintNode node;
+    node.vertices = arena.Copy(points, count);
+    node.transform = transform;
+    node.color = color;
+    node.strokeWidth = width;
+    paintNodes.push_back(node);
+}
+
+void Surface::Clear() {
+    paintNodes.clear();
+    arena.Reset();
+}
 
 void Surface::GenerateGeometry(
     RenderData& renderData, CommandList& cmdList, FSize2 windowSize) {
+    std::size_t numVertices = 0;
+    std::size_t numIndices = 0;
+    for (auto const& node : paintNodes) {
+        numVertices += node.NumVertices();
+        numIndices += node.NumIndices();
+    }
+
+    // Everything is written straight into the render data; there is no
+    // intermediate per-node vertex array.
+    std::size_t vertexOffset = renderData.vertices.size();
+    std::size_t indexOffset = renderData.indices.size();
+    renderData.vertices.resize(vertexOffset + numVertices);
+    renderData.indices.resize(indexOffset + numIndices);
+
+    bool const perVertexColor
+        = renderData.vertexFormat == VertexFormat::PositionColor;
+    if (perVertexColor) {
+        renderData.colors.resize(vertexOffset + numVertices);
+    }
+
+    FVector2 const toWindow{1.f / windowSize.x, 1.f / windowSize.y};
     for (auto const& node : paintNodes) {
-        // TODO: A little inefficient
-        std::vector<Vertex> vertices;
-        vertices.reserve(node.path.vertices.size());
-        for (auto const pt : node.path.vertices) {
-            Vertex vtx;
-            // Sometimes causes strange transformations
-            vtx.position.x = pt.x / windowSize.x;
-            vtx.position.y = pt.y / windowSize.y;
-            vertices.push_back(vtx);
+        // Paint transform and normalization folded into one scale and offset.
+        FVector2 const scale = node.transform.scale * toWindow;
+        FVector2 const offset = node.transform.offset * toWindow;
+
+        Vertex* vertex = renderData.vertices.data() + vertexOffset;
+        if (node.strokeWidth > 0.f) {
+            // Indices count from the command's vertexOffset.
+            ExpandPolyline(node.vertices.data, node.vertices.size,
+                node.strokeWidth, PolylineMiterLimit, scale, offset, vertex,
+                renderData.indices.data() + indexOffset, 0);
+        } else {
+            for (auto const pt : node.vertices) {
+                vertex->position.x = pt.x * scale.x + offset.x;
+                vertex->position.y = pt.y * scale.y + offset.y;
+                ++vertex;
+            }
+            std::copy(node.indices.begin(), node.indices.end(),
+                renderData.indices.begin() + indexOffset);
+        }
+
+        if (perVertexColor) {
+            std::fill_n(renderData.colors.begin() + vertexOffset,
+                node.NumVertices(), VertexColor::FromColor(node.color));
         }
 
-        renderData.PushGeometry(cmdList, vertices, node.path.indices, node.color);
+        CmdDrawTriangles command;
+        command.indexOffset = indexOffset;
+        command.vertexOffset = vertexOffset;
+        command.numIndices = node.NumIndices();
+        command.color = node.color;
+        cmdList.PushCommand(command);
+
+        vertexOffset += node.NumVertices();
+        indexOffset += node.NumIndices();
     }
 }
 
-} // namespace xu
\ No newline at end of file
+bool Surface::PaintedBounds(std::size_t firstNode, FBounds2& bounds) const {
+    bool painted = false;
+    for (std::size_t i = firstNode; i < paintNodes.size(); ++i) {
+        PaintTransform const& transform = paintNodes[i].transform;
+        // How far a polyline's stroke can reach past its points.
+        float const reach
+            = paintNodes[i].strokeWidth * PolylineMiterLimit / 2.f;
+        for (auto const pt : paintNodes[i].vertices) {
+            FPoint2 const a = (pt - reach) * transform.scale + transform.offset;
+            FPoint2 const b = (pt + reach) * transform.scale + transform.offset;
+            FBounds2 const point{a, b};
+            bounds = painted ? bounds.Union(point) : point;
+            painted = true;
+        }
+    }
+    return painted;
+}
+
+std::size_t Surface::PaintNode::NumVertices() const {
+    // A polyline has a left and a right vertex per point.
+    return strokeWidth > 0.f ? 2 * vertices.size : vertices.size;
+}
+
+std::size_t Surface::PaintNode::NumIndices() const {
+    // And two triangles per segment.
+    return strokeWidth > 0.f ? 6 * (vertices.size - 1) : indices.size;
+}
+
+} // namespace xu
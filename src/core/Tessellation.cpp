@@ -24,12 +24,54 @@
 
 #include <mapbox/earcut.hpp>
 
-#include <optional>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <array>
+#include <cmath>
+#include <limits>
+
+// SSE2 is part of the x86-64 baseline, so it needs neither compiler flags nor
+// runtime detection there. Other targets use the scalar kernels.
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define XU_TESSELLATION_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define XU_TESSELLATION_SSE2 0
+#endif
+
+// Lets earcut read FPoint2 directly.
+namespace mapbox::util {
+
+template<>
+struct nth<0, xu::FPoint2> {
+    inline static float get(xu::FPoint2 const& point) { return point.x; }
+};
+
+template<>
+struct nth<1, xu::FPoint2> {
+    inline static float get(xu::FPoint2 const& point) { return point.y; }
+};
+
+} // namespace mapbox::util
 
 namespace xu {
 
+// Ring of a polygon as earcut expects it, viewing points stored elsewhere so
+// they are not copied.
+struct PolygonRing {
+    using value_type = FPoint2;
+
+    FPoint2 const* points;
+    std::size_t count;
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    FPoint2 const& operator[](std::size_t i) const { return points[i]; }
+};
+
+static const double PI = std::atan(1.0) * 4.;
+
 // All of the following quadratic-related functions have been taken from:
 // https://raphlinus.github.io/graphics/curves/2019/12/23/flatten-quadbez.html
 
@@ -62,25 +104,196 @@ static BasicQuadBez MapToBasic(QuadBez const& bez) {
 
 static float ApproxMyint(float x) {
     const auto d = 0.67f;
-    return x / (1 - d + std::pow(std::pow(d, 4.f) + 0.25 * x * x, 0.25));
+    const auto d4 = d * d * d * d;
+    return x / (1 - d + std::sqrt(std::sqrt(d4 + 0.25f * x * x)));
 }
 
 static float ApproxInvMyint(float x) {
-    const auto b = 0.39;
+    const auto b = 0.39f;
     return x * (1.f - b + std::sqrt(b * b + 0.25f * x * x));
 }
 
 static FPoint2 EvaluateQuadraticBez(QuadBez const& bez, float t) {
     const auto mt = 1.f - t;
-    const auto x
-        = bez.p0.x * mt * mt + 2 * bez.p1.x * t * mt + bez.p2.x * t * t;
-    const auto y
-        = bez.p0.y * mt * mt + 2 * bez.p1.y * t * mt + bez.p2.y * t * t;
+    const auto w0 = mt * mt;
+    const auto w1 = 2.f * (t * mt);
+    const auto w2 = t * t;
+    const auto x = w0 * bez.p0.x + w1 * bez.p1.x + w2 * bez.p2.x;
+    const auto y = w0 * bez.p0.y + w1 * bez.p1.y + w2 * bez.p2.y;
     return FPoint2{x, y};
 }
 
-static std::vector<FPoint2> FlattenQuadratic(
-    FPoint2 from, FPoint2 to, FPoint2 p0, double quality) {
+#if XU_TESSELLATION_SSE2
+static std::atomic<bool> simdKernelsEnabled{true};
+#endif
+
+void SetSimdKernelsEnabled(bool enabled) {
+#if XU_TESSELLATION_SSE2
+    simdKernelsEnabled.store(enabled, std::memory_order_relaxed);
+#else
+    (void)enabled;
+#endif
+}
+
+bool SimdKernelsAvailable() { return XU_TESSELLATION_SSE2; }
+
+// Batch kernels used by the flatteners. They write count points to out, four
+// at a time with SSE2 where available. The scalar code performs the same
+// float operations in the same order, so both give bit-identical points.
+
+static_assert(sizeof(FPoint2) == 2 * sizeof(float),
+    "Kernels store points as interleaved x/y floats");
+
+// Evaluates the quadratic at t_i = (ApproxInvMyint(a + da * i) - u0) * uscale
+// for i in [0, count), i.e. at evenly spaced steps of the parabola integral.
+static void EvaluateQuadraticSubdivision(QuadBez const& bez, float a,
+    float da, float u0, float uscale, std::size_t count, FPoint2* out) {
+    std::size_t i = 0;
+#if XU_TESSELLATION_SSE2
+    const bool simd = simdKernelsEnabled.load(std::memory_order_relaxed);
+    const auto b = _mm_set1_ps(0.39f);
+    const auto oneMinusB = _mm_set1_ps(1.f - 0.39f);
+    const auto quarter = _mm_set1_ps(0.25f);
+    const auto one = _mm_set1_ps(1.f);
+    const auto two = _mm_set1_ps(2.f);
+    const auto p0x = _mm_set1_ps(bez.p0.x);
+    const auto p0y = _mm_set1_ps(bez.p0.y);
+    const auto p1x = _mm_set1_ps(bez.p1.x);
+    const auto p1y = _mm_set1_ps(bez.p1.y);
+    const auto p2x = _mm_set1_ps(bez.p2.x);
+    const auto p2y = _mm_set1_ps(bez.p2.y);
+    const auto u0v = _mm_set1_ps(u0);
+    const auto uscalev = _mm_set1_ps(uscale);
+    const auto av0 = _mm_set1_ps(a);
+    const auto dav = _mm_set1_ps(da);
+    const auto lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+    float* dst = &out->x;
+    for (; simd && i + 4 <= count; i += 4, dst += 8) {
+        // a + da * i, computed from i rather than accumulated so that it
+        // matches the scalar code exactly.
+        const auto av = _mm_add_ps(av0,
+            _mm_mul_ps(dav,
+                _mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lanes)));
+
+        // ApproxInvMyint
+        const auto root = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(b, b),
+            _mm_mul_ps(quarter, _mm_mul_ps(av, av))));
+        const auto u = _mm_mul_ps(av, _mm_add_ps(oneMinusB, root));
+        const auto t = _mm_mul_ps(_mm_sub_ps(u, u0v), uscalev);
+
+        const auto mt = _mm_sub_ps(one, t);
+        const auto w0 = _mm_mul_ps(mt, mt);
+        const auto w1 = _mm_mul_ps(two, _mm_mul_ps(t, mt));
+        const auto w2 = _mm_mul_ps(t, t);
+        const auto x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, p0x),
+                                      _mm_mul_ps(w1, p1x)),
+            _mm_mul_ps(w2, p2x));
+        const auto y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, p0y),
+                                      _mm_mul_ps(w1, p1y)),
+            _mm_mul_ps(w2, p2y));
+
+        _mm_storeu_ps(dst, _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(x, y));
+    }
+#endif
+    for (; i < count; ++i) {
+        const auto t = (ApproxInvMyint(a + da * i) - u0) * uscale;
+        out[i] = EvaluateQuadraticBez(bez, t);
+    }
+}
+
+// Evaluates the circle at angles startAngle + step * i for i in [0, count).
+// Points are produced by rotating the previous ones instead of calling sin and
+// cos for each; the rotation is reseeded regularly to bound drift.
+static void EvaluateArc(FPoint2 center, float radius, float startAngle,
+    float step, std::size_t count, FPoint2* out) {
+    constexpr std::size_t ReseedInterval = 64;
+
+#if XU_TESSELLATION_SSE2
+    const bool simd = simdKernelsEnabled.load(std::memory_order_relaxed);
+#endif
+    for (std::size_t block = 0; block < count; block += ReseedInterval) {
+        const std::size_t blockCount = std::min(count - block, ReseedInterval);
+        const float blockStart = startAngle + step * block;
+        std::size_t i = 0;
+        if (blockCount >= 4) {
+            // Four interleaved rotations, each advancing by four steps.
+            alignas(16) float c[4];
+            alignas(16) float s[4];
+            for (int lane = 0; lane < 4; ++lane) {
+                c[lane] = std::cos(blockStart + step * lane);
+                s[lane] = std::sin(blockStart + step * lane);
+            }
+            const float rc = std::cos(4.f * step);
+            const float rs = std::sin(4.f * step);
+#if XU_TESSELLATION_SSE2
+            if (simd) {
+                auto cv = _mm_load_ps(c);
+                auto sv = _mm_load_ps(s);
+                const auto rcv = _mm_set1_ps(rc);
+                const auto rsv = _mm_set1_ps(rs);
+                const auto r = _mm_set1_ps(radius);
+                const auto cx = _mm_set1_ps(center.x);
+                const auto cy = _mm_set1_ps(center.y);
+                float* dst = &out[block].x;
+                for (; i + 4 <= blockCount; i += 4, dst += 8) {
+                    const auto x = _mm_add_ps(cx, _mm_mul_ps(cv, r));
+                    const auto y = _mm_add_ps(cy, _mm_mul_ps(sv, r));
+                    _mm_storeu_ps(dst, _mm_unpacklo_ps(x, y));
+                    _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(x, y));
+
+                    const auto nc = _mm_sub_ps(
+                        _mm_mul_ps(cv, rcv), _mm_mul_ps(sv, rsv));
+                    sv = _mm_add_ps(_mm_mul_ps(sv, rcv), _mm_mul_ps(cv, rsv));
+                    cv = nc;
+                }
+            }
+#endif
+            for (; i + 4 <= blockCount; i += 4) {
+                for (int lane = 0; lane < 4; ++lane) {
+                    out[block + i + lane]
+                        = FPoint2{center.x + c[lane] * radius,
+                            center.y + s[lane] * radius};
+                    const float nc = c[lane] * rc - s[lane] * rs;
+                    s[lane] = s[lane] * rc + c[lane] * rs;
+                    c[lane] = nc;
+                }
+            }
+        }
+        if (i < blockCount) {
+            float c = std::cos(blockStart + step * i);
+            float s = std::sin(blockStart + step * i);
+            const float rc = std::cos(step);
+            const float rs = std::sin(step);
+            for (; i < blockCount; ++i) {
+                out[block + i]
+                    = FPoint2{center.x + c * radius, center.y + s * radius};
+                const float nc = c * rc - s * rs;
+                s = s * rc + c * rs;
+                c = nc;
+            }
+        }
+    }
+}
+
+// Grows out by count points and returns a pointer to the first new one.
+static FPoint2* AppendUninitialized(
+    std::vector<FPoint2>& out, std::size_t count) {
+    out.resize(out.size() + count);
+    return out.data() + out.size() - count;
+}
+
+// Appends a point to the polygon that starts at out[begin]. The first point of
+// a segment is usually the last point of the previous one, so it is dropped
+// when it repeats the previous point.
+static void AppendSegmentStart(
+    std::vector<FPoint2>& out, std::size_t begin, FPoint2 point) {
+    if (out.size() > begin && out.back() == point) { return; }
+    out.push_back(point);
+}
+
+static void FlattenQuadratic(FPoint2 from, FPoint2 to, FPoint2 p0,
+    double quality, std::vector<FPoint2>& out, std::size_t begin) {
     const auto bez = QuadBez{from, p0, to};
     const auto tol = 1.f / quality;
     const auto params = MapToBasic(bez);
@@ -91,171 +304,253 @@ static std::vector<FPoint2> FlattenQuadratic(
     const auto u0 = ApproxInvMyint(a0);
     const auto u2 = ApproxInvMyint(a2);
 
-    std::vector<float> result;
-    result.push_back(0.f);
-    if (std::isfinite(n)) {
-        result.reserve(n + 2);
-        for (std::size_t i = 1; i < n; ++i) {
-            const auto u = ApproxInvMyint(a0 + ((a2 - a0) * i) / n);
-            const auto t = (u - u0) / (u2 - u0);
-            result.push_back(t);
-        }
+    AppendSegmentStart(out, begin, EvaluateQuadraticBez(bez, 0.f));
+    if (std::isfinite(n) && n > 1) {
+        const auto inner = static_cast<std::size_t>(n) - 1;
+        const auto da = (a2 - a0) / n;
+        EvaluateQuadraticSubdivision(bez, a0 + da, da, u0, 1.f / (u2 - u0),
+            inner, AppendUninitialized(out, inner));
     }
-    result.push_back(1.f);
+    out.push_back(EvaluateQuadraticBez(bez, 1.f));
+}
 
-    std::vector<FPoint2> points;
-    points.reserve(result.size());
-    for (auto const& t : result) {
-        points.push_back(EvaluateQuadraticBez(bez, t));
-    }
-    return points;
+// Cubics are flattened by approximating them with quadratics, which are then
+// flattened together using the same parabola integral as above, so points are
+// spread over the whole curve according to curvature. This is the approach
+// used by kurbo:
+// https://github.com/linebender/kurbo/blob/master/kurbo/src/bezpath.rs
+
+struct CubicBez {
+    FPoint2 p0;
+    FPoint2 p1;
+    FPoint2 p2;
+    FPoint2 p3;
+};
+
+static FPoint2 EvaluateCubicBez(CubicBez const& bez, float t) {
+    const auto mt = 1.f - t;
+    const auto a = mt * mt * mt;
+    const auto b = 3.f * mt * mt * t;
+    const auto c = 3.f * mt * t * t;
+    const auto d = t * t * t;
+    return FPoint2{a * bez.p0.x + b * bez.p1.x + c * bez.p2.x + d * bez.p3.x,
+        a * bez.p0.y + b * bez.p1.y + c * bez.p2.y + d * bez.p3.y};
 }
 
-// https://gist.github.com/rlindsay/c55be560ec41144f521f
-static std::vector<FPoint2> FlattenCubic(
-    FPoint2 p1, FPoint2 p2, FPoint2 p3, FPoint2 p4, double quality) {
-    const auto numLines
-        = (static_cast<std::size_t>((p4 - p1).Magnitude() * 2)) + 1;
-    std::vector<FPoint2> points;
-    points.resize(numLines);
+static FVector2 EvaluateCubicDerivative(CubicBez const& bez, float t) {
+    const auto mt = 1.f - t;
+    const auto a = 3.f * mt * mt;
+    const auto b = 6.f * mt * t;
+    const auto c = 3.f * t * t;
+    return FVector2{a * (bez.p1.x - bez.p0.x) + b * (bez.p2.x - bez.p1.x)
+            + c * (bez.p3.x - bez.p2.x),
+        a * (bez.p1.y - bez.p0.y) + b * (bez.p2.y - bez.p1.y)
+            + c * (bez.p3.y - bez.p2.y)};
+}
 
-    const float cx = 3 * (p2.x - p1.x);
-    const float cy = 3 * (p2.y - p1.y);
-    const float bx = 3 * (p3.x - p2.x) - cx;
-    const float by = 3 * (p3.y - p2.y) - cy;
-    const float ax = p4.x - p1.x - cx - bx;
-    const float ay = p4.y - p1.y - cy - by;
-    const float h = 1.f / numLines;
-    const float hh = h * h;
-    const float hhh = hh * h;
-    // TODO: optimize this
-    float d1x = ax * hhh + bx * hh + cx * h;
-    float d1y = ay * hhh + by * hh + cy * h;
-    float d2x = 6 * ax * hhh + 2 * bx * hh;
-    float d2y = 6 * ay * hhh + 2 * by * hh;
-    float d3x = 6 * ax * hhh;
-    float d3y = 6 * ay * hhh;
+// Number of quadratics needed to stay within the given error of the cubic.
+static std::size_t CubicQuadCount(CubicBez const& bez, float tol) {
+    const auto p1x2 = bez.p1 * 3.f - bez.p0;
+    const auto p2x2 = bez.p2 * 3.f - bez.p3;
+    const auto err = (p2x2 - p1x2).Magnitude2();
+    const auto n = std::ceil(std::pow(err / (432.f * tol * tol), 1.f / 6.f));
+    return std::isfinite(n)
+        ? std::max(static_cast<std::size_t>(n), std::size_t{1})
+        : std::size_t{1};
+}
 
-    FPoint2 curr = p1;
-    points[0] = curr;
-    for (auto& point : points) {
-        curr.x += d1x;
-        curr.y += d1y;
+// The i-th of n quadratics approximating the cubic.
+static QuadBez CubicToQuad(CubicBez const& bez, std::size_t i, std::size_t n) {
+    const auto t0 = static_cast<float>(i) / n;
+    const auto t1 = static_cast<float>(i + 1) / n;
+    const auto p0 = EvaluateCubicBez(bez, t0);
+    const auto p3 = EvaluateCubicBez(bez, t1);
+    const auto scale = (t1 - t0) / 3.f;
+    const auto p1 = p0 + EvaluateCubicDerivative(bez, t0) * scale;
+    const auto p2 = p3 - EvaluateCubicDerivative(bez, t1) * scale;
+    return QuadBez{p0, ((p1 + p2) * 3.f - p0 - p3) / 4.f, p3};
+}
 
-        d1x += d2x;
-        d1y += d2y;
+struct QuadSubdivision {
+    float a0;
+    float a2;
+    float u0;
+    float uscale;
+    // Number of segments needed for this quadratic, times 2 * sqrt(tol).
+    float val;
+};
 
-        d2x += d3x;
-        d2y += d3y;
+static QuadSubdivision EstimateSubdivision(QuadBez const& bez, float sqrtTol) {
+    const auto params = MapToBasic(bez);
+    const auto a0 = ApproxMyint(params.x0);
+    const auto a2 = ApproxMyint(params.x2);
 
-        point = curr;
+    float val = 0.f;
+    if (std::isfinite(params.scale)) {
+        const auto da = std::abs(a2 - a0);
+        const auto sqrtScale = std::sqrt(params.scale);
+        if ((params.x0 < 0.f) == (params.x2 < 0.f)) {
+            val = da * sqrtScale;
+        } else {
+            // The cusp lies inside the curve; bound the integral near it.
+            const auto xmin = sqrtTol / sqrtScale;
+            val = sqrtTol * da / ApproxMyint(xmin);
+        }
     }
-    points.back() = p4;
 
-    return points;
+    const auto u0 = ApproxInvMyint(a0);
+    const auto u2 = ApproxInvMyint(a2);
+    return QuadSubdivision{a0, a2, u0, 1.f / (u2 - u0), val};
 }
 
-static float Lerp(float a, float b, float f) { return a + f * (b - a); }
+static void FlattenCubic(FPoint2 p1, FPoint2 p2, FPoint2 p3, FPoint2 p4,
+    double quality, std::vector<FPoint2>& out, std::size_t begin) {
+    const auto bez = CubicBez{p1, p2, p3, p4};
+    const auto tol = static_cast<float>(1. / quality);
+    // A tenth of the error budget goes to the quadratic approximation.
+    const auto quadTol = tol * 0.1f;
+    const auto sqrtTol = std::sqrt(tol * 0.9f);
+    const auto numQuads = CubicQuadCount(bez, quadTol);
+
+    // Quadratics are recomputed rather than stored, so nothing is allocated.
+    float sum = 0.f;
+    for (std::size_t i = 0; i < numQuads; ++i) {
+        sum += EstimateSubdivision(CubicToQuad(bez, i, numQuads), sqrtTol).val;
+    }
+    const auto count = std::ceil(0.5f * sum / sqrtTol);
+    const auto n = std::isfinite(count)
+        ? std::max(static_cast<std::size_t>(count), std::size_t{1})
+        : std::size_t{1};
+
+    AppendSegmentStart(out, begin, p1);
+
+    // Place the n - 1 inner points at equal steps of the summed integral.
+    const auto step = sum / n;
+    std::size_t i = 1;
+    float valSum = 0.f;
+    for (std::size_t q = 0; q < numQuads && i < n; ++q) {
+        const auto quad = CubicToQuad(bez, q, numQuads);
+        const auto params = EstimateSubdivision(quad, sqrtTol);
+
+        // Points i..last - 1 fall on this quadratic. Their integral values,
+        // and so their a values, are evenly spaced.
+        std::size_t last = i;
+        while (last < n && last * step < valSum + params.val) { ++last; }
+        if (last > i) {
+            const auto k = (params.a2 - params.a0) / params.val;
+            EvaluateQuadraticSubdivision(quad,
+                params.a0 + k * (i * step - valSum), k * step, params.u0,
+                params.uscale, last - i, AppendUninitialized(out, last - i));
+            i = last;
+        }
+        valSum += params.val;
+    }
+    out.push_back(p4);
+}
 
 static FPoint2 PointForAngle(float radians, FPoint2 center, float radius) {
-    const float s = std::sinf(radians);
-    const float c = std::cosf(radians);
+    const float s = std::sin(radians);
+    const float c = std::cos(radians);
     return FPoint2{c * radius + center.x, s * radius + center.y};
 }
 
-static std::vector<FPoint2> FlattenArc(FPoint2 center, float radius,
-    float startAngle, float endAngle, double quality) {
-    std::vector<FPoint2> polygon;
-    for (size_t i = 0; i < std::ceil(quality); ++i) {
-        float t = i / static_cast<float>(std::ceil(quality));
-        polygon.push_back(
-            PointForAngle(Lerp(startAngle, endAngle, t), center, radius));
-    }
-    return polygon;
+// The number of segments is chosen so that the distance between each chord
+// and the arc (the sagitta, r * (1 - cos(theta / 2))) stays within tolerance.
+static std::size_t ArcSegmentCount(float radius, float sweep, double quality) {
+    const auto tol = 1.f / quality;
+    const auto x = 1. - tol / std::abs(radius);
+    // Past half a turn per segment the chord no longer gets closer to the arc.
+    const auto maxStep = x > -1. ? 2. * std::acos(x) : PI;
+    const auto count = std::ceil(std::abs(sweep) / maxStep);
+    return std::isfinite(count)
+        ? std::max(static_cast<std::size_t>(count), std::size_t{1})
+        : std::size_t{1};
 }
 
-static std::vector<FPoint2> MergeDuplicatePoints(
-    std::vector<FPoint2> const& polygon) {
-    std::vector<FPoint2> merged;
-    for (auto const& point : polygon) {
-        if (merged.size() > 0 && merged.back() == point) { continue; }
-        merged.push_back(point);
+static void FlattenArc(FPoint2 center, float radius, float startAngle,
+    float endAngle, double quality, std::vector<FPoint2>& out,
+    std::size_t begin) {
+    const auto n = ArcSegmentCount(radius, endAngle - startAngle, quality);
+
+    AppendSegmentStart(out, begin, PointForAngle(startAngle, center, radius));
+    if (n > 1) {
+        const auto step = (endAngle - startAngle) / n;
+        EvaluateArc(center, radius, startAngle + step, step, n - 1,
+            AppendUninitialized(out, n - 1));
     }
-    return merged;
+    out.push_back(PointForAngle(endAngle, center, radius));
 }
 
-std::vector<FPoint2> FlattenPath(VectorPath const& path, double quality) {
-    std::vector<FPoint2> polygon;
+static void FlattenContours(VectorPath const& path, double quality,
+    std::vector<FPoint2>& out, std::vector<ContourEnd>* contourEnds) {
+    // Start of the current contour in out.
+    std::size_t begin = out.size();
+
+    auto const endContour = [&](bool closed) {
+        if (out.size() == begin) { return; }
+        if (contourEnds) { contourEnds->push_back({out.size(), closed}); }
+        begin = out.size();
+    };
 
     FPoint2 curr = path.start;
     for (auto const& event : path.events) {
         switch (event.type) {
+            case VectorPathEventType::Move: {
+                endContour(false);
+                curr = event.params.move.to;
+                break;
+            }
+            case VectorPathEventType::Close: {
+                if (out.size() == begin) { break; }
+                curr = out[begin];
+                if (out.back() != curr) { out.push_back(curr); }
+                endContour(true);
+                break;
+            }
             case VectorPathEventType::Line: {
-                if (polygon.empty() || polygon.back() != curr)
-                    polygon.push_back(curr);
+                AppendSegmentStart(out, begin, curr);
                 curr = event.params.line.to;
-                polygon.push_back(curr);
+                out.push_back(curr);
                 break;
             }
             case VectorPathEventType::Quadratic: {
-                const auto points
-                    = FlattenQuadratic(curr, event.params.quadratic.to,
-                        event.params.quadratic.x0, quality);
-
-                if (points.empty()) continue;
-                // back() is invalid on an empty vector, so we need to make this
-                // distinction
-                if (polygon.empty()) {
-                    polygon.insert(polygon.end(), points.begin(), points.end());
-                } else {
-                    polygon.insert(polygon.end(),
-                        points.begin()
-                            + (points.front() == polygon.back() ? 1 : 0),
-                        points.end());
-                }
-                curr = points.back();
+                FlattenQuadratic(curr, event.params.quadratic.to,
+                    event.params.quadratic.x0, quality, out, begin);
+                curr = out.back();
                 break;
             }
             case VectorPathEventType::Cubic: {
-                const auto points = FlattenCubic(curr, event.params.cubic.to,
-                    event.params.cubic.x0, event.params.cubic.x1, quality);
-
-                if (points.empty()) continue;
-                // back() is invalid on an empty vector, so we need to make this
-                // distinction
-                if (polygon.empty()) {
-                    polygon.insert(polygon.end(), points.begin(), points.end());
-                } else {
-                    polygon.insert(polygon.end(),
-                        points.begin()
-                            + (points.front() == polygon.back() ? 1 : 0),
-                        points.end());
-                }
-                curr = points.back();
+                FlattenCubic(curr, event.params.cubic.x0,
+                    event.params.cubic.x1, event.params.cubic.to, quality, out,
+                    begin);
+                curr = out.back();
                 break;
             }
             case VectorPathEventType::Arc: {
-                const auto points = FlattenArc(event.params.arc.center,
-                    event.params.arc.radius, event.params.arc.startAngle,
-                    event.params.arc.endAngle, quality);
-
-                if (points.empty()) continue;
-                // back() is invalid on an empty vector, so we need to make this
-                // distinction
-                if (polygon.empty()) {
-                    polygon.insert(polygon.end(), points.begin(), points.end());
-                } else {
-                    polygon.insert(polygon.end(),
-                        points.begin()
-                            + (points.front() == polygon.back() ? 1 : 0),
-                        points.end());
-                }
-                curr = points.back();
+                FlattenArc(event.params.arc.center, event.params.arc.radius,
+                    event.params.arc.startAngle, event.params.arc.endAngle,
+                    quality, out, begin);
+                curr = out.back();
                 break;
             }
         }
     }
+    endContour(false);
+}
+
+void FlattenPath(
+    VectorPath const& path, double quality, std::vector<FPoint2>& out) {
+    FlattenContours(path, quality, out, nullptr);
+}
+
+void FlattenPath(VectorPath const& path, double quality,
+    std::vector<FPoint2>& out, std::vector<ContourEnd>& contourEnds) {
+    FlattenContours(path, quality, out, &contourEnds);
+}
 
+std::vector<FPoint2> FlattenPath(VectorPath const& path, double quality) {
+    std::vector<FPoint2> polygon;
+    FlattenPath(path, quality, polygon);
     return polygon;
 }
 
@@ -267,201 +562,726 @@ inline static FVector2 PolylineNormal(FVector2 direction) {
     return FVector2{-direction.y, direction.x};
 }
 
-static void PolylineExtrusions(
-    std::vector<FPoint2>& points, FPoint2 point, FVector2 normal, float scale) {
-    points.push_back(point + (normal * -scale));
-    points.push_back(point + (normal * scale));
-}
-
-static float PolylineComputeMiter(FVector2& tangent, FVector2 miter,
-    FPoint2 lineA, FPoint2 lineB, float halfThick) {
-    tangent = lineA + lineB;
-    tangent = tangent.Normalized();
-    miter = {-tangent.y, tangent.x};
-    const FVector2 tmp{-lineA.y, lineA.x};
-    return halfThick / ((miter.x * tmp.x) + (miter.y * tmp.y));
-}
-
+// Expands a polyline into a strip of triangles with a cap at either end and a
+// join at every corner. The strip is extended from a pair of edge vertices,
+// left and right of the direction of travel.
 struct PolylineExpansion {
-    FVector2 tmp{0.f, 0.f};
-    FVector2 capEnd{0.f, 0.f};
-    FVector2 lineA{0.f, 0.f};
-    FVector2 lineB{0.f, 0.f};
-    FVector2 tangent{0.f, 0.f};
-    FVector2 miter{0.f, 0.f};
-
-    float miterLimit;
-    float thickness;
-    LineJoin join;
-    LineCap cap;
+    float halfWidth = 0.f;
+    float miterLimit = 1.f;
+    double quality = 1.;
+    LineJoin join = LineJoin::Miter;
+    LineCap cap = LineCap::Butt;
+
+    // Where the next vertex and index are written. The buffers are sized for
+    // Bound() up front, so nothing is reallocated while expanding.
+    FPoint2* vertex = nullptr;
+    uint32_t* index = nullptr;
+    uint32_t nextVertex = 0;
+
+    uint32_t left = 0;
+    uint32_t right = 0;
+    // The first pair of edge vertices, which a closed strip ends on.
+    uint32_t firstLeft = 0;
+    uint32_t firstRight = 0;
+    bool started = false;
+
+    // Upper bound on the vertices and indices Build() writes for numPoints
+    // points, which follows from the cap and join types alone.
+    std::pair<std::size_t, std::size_t> Bound(
+        std::size_t numPoints, bool closed) const {
+        if (numPoints < 2) { return {0, 0}; }
+
+        // At worst a join is beveled, or rounded over half a turn.
+        std::size_t const arc = ArcSegmentCount(halfWidth, PI, quality);
+        std::size_t const perJoin = join == LineJoin::Round ? 2 + arc : 3;
+
+        std::size_t numVertices;
+        std::size_t numTriangles;
+        if (closed) {
+            numVertices = numPoints * perJoin;
+            numTriangles = numPoints * perJoin + 2;
+        } else {
+            std::size_t const perCap = cap == LineCap::Round ? arc - 1 : 0;
+            numVertices = 2 * (2 + perCap) + (numPoints - 2) * perJoin;
+            numTriangles = 2 * perCap + 2 + (numPoints - 2) * perJoin;
+        }
+        return {numVertices, 3 * numTriangles};
+    }
 
-    std::optional<FVector2> normal;
-    int lastFlip;
-    bool started;
+    // Writes through vertex and index; indices count from nextVertex. A closed
+    // polyline is expected to end on its first point and is joined there, so
+    // the seam shares its vertices instead of overlapping two caps.
+    void Build(FPoint2 const* points, std::size_t numPoints, bool closed) {
+        started = false;
 
-    auto Build(std::vector<FPoint2> const& points) {
-        std::pair<std::vector<FPoint2>, std::vector<uint32_t>> output;
+        if (closed) {
+            while (numPoints > 1 && points[numPoints - 1] == points[0]) {
+                --numPoints;
+            }
+        }
 
-        if (points.size() <= 1) return output;
+        // Repeated points have no direction, so they are skipped.
+        auto const nextDistinct = [&](std::size_t i) {
+            std::size_t j = i + 1;
+            while (j < numPoints && points[j] == points[i]) { ++j; }
+            return j;
+        };
+
+        std::size_t i = nextDistinct(0);
+        if (i >= numPoints) { return; }
+
+        FVector2 direction = PolylineDirection(points[i], points[0]);
+        float length = (points[i] - points[0]).Magnitude();
+
+        FVector2 closing;
+        float closingLength = 0.f;
+        if (closed) {
+            FPoint2 const last = points[numPoints - 1];
+            closing = PolylineDirection(points[0], last);
+            closingLength = (points[0] - last).Magnitude();
+            Join(points[0], closing, direction,
+                std::min(closingLength, length));
+        } else {
+            StartCap(points[0], direction);
+        }
 
-        lastFlip = -1;
-        started = false;
-        normal = std::nullopt;
-
-        for (std::size_t i = 1, count = 0; i < points.size(); i++) {
-            FVector2 last = points[i - 1];
-            FVector2 cur = points[i];
-            std::optional<FVector2> next = i < points.size() - 1
-                ? std::optional<FVector2>{points[i + 1]}
-                : std::nullopt;
-            int amt = PolylineSegment(
-                output, count, last, cur, next, thickness / 2);
-            count += amt;
+        for (std::size_t j = nextDistinct(i); j < numPoints;
+             j = nextDistinct(i)) {
+            FVector2 const next = PolylineDirection(points[j], points[i]);
+            float const nextLength = (points[j] - points[i]).Magnitude();
+            Join(points[i], direction, next, std::min(length, nextLength));
+            direction = next;
+            length = nextLength;
+            i = j;
         }
 
-        return output;
+        if (closed) {
+            Join(points[i], direction, closing,
+                std::min(length, closingLength));
+            Advance(firstLeft, firstRight);
+        } else {
+            EndCap(points[i], direction);
+        }
     }
 
-    int PolylineSegment(
-        std::pair<std::vector<FPoint2>, std::vector<uint32_t>>& output,
-        int index, FVector2 last, FVector2 cur, std::optional<FVector2> next,
-        float halfThick) {
-        int count = 0;
-        const bool capSquare = cap == LineCap::Square;
-        const bool joinBevel = join == LineJoin::Bevel;
-
-        lineA = PolylineDirection(cur, last);
+    uint32_t Emit(FPoint2 point) {
+        *vertex++ = point;
+        return nextVertex++;
+    }
 
-        if (!normal) { normal = PolylineNormal(lineA); }
+    void Triangle(uint32_t a, uint32_t b, uint32_t c) {
+        index[0] = a;
+        index[1] = b;
+        index[2] = c;
+        index += 3;
+    }
 
-        if (!started) {
+    // Extends the strip to a new pair of edge vertices, or starts it.
+    void Advance(uint32_t newLeft, uint32_t newRight) {
+        if (started) {
+            Triangle(left, right, newLeft);
+            Triangle(newLeft, right, newRight);
+        } else {
             started = true;
+            firstLeft = newLeft;
+            firstRight = newRight;
+        }
+        left = newLeft;
+        right = newRight;
+    }
 
-            if (capSquare) {
-                capEnd = last + (lineA * -halfThick);
-                last = capEnd;
+    // Fans from pivot over the arc around center that starts at vertex first
+    // (center + from) and sweeps to vertex last.
+    void Arc(uint32_t pivot, uint32_t first, uint32_t last, FPoint2 center,
+        FVector2 from, float sweep) {
+        std::size_t const count = ArcSegmentCount(halfWidth, sweep, quality);
+        float const c = std::cos(sweep / count);
+        float const s = std::sin(sweep / count);
+
+        uint32_t previous = first;
+        for (std::size_t k = 1; k <= count; ++k) {
+            uint32_t current = last;
+            if (k < count) {
+                from = {from.x * c - from.y * s, from.x * s + from.y * c};
+                current = Emit(center + from);
             }
+            if (previous != pivot) { Triangle(pivot, previous, current); }
+            previous = current;
+        }
+    }
 
-            PolylineExtrusions(output.first, last, normal.value(), halfThick);
+    void StartCap(FPoint2 point, FVector2 direction) {
+        FVector2 const normal = PolylineNormal(direction) * halfWidth;
+        if (cap == LineCap::Square) { point -= direction * halfWidth; }
+
+        Advance(Emit(point + normal), Emit(point - normal));
+        if (cap == LineCap::Round) {
+            Arc(right, right, left, point, normal * -1.f, -PI);
         }
+    }
 
-        output.second.push_back(index);
-        output.second.push_back(index + 1);
-        output.second.push_back(index + 2);
+    void EndCap(FPoint2 point, FVector2 direction) {
+        FVector2 const normal = PolylineNormal(direction) * halfWidth;
+        if (cap == LineCap::Square) { point += direction * halfWidth; }
 
-        if (!next) {
-            normal = PolylineNormal(lineA);
+        Advance(Emit(point + normal), Emit(point - normal));
+        if (cap == LineCap::Round) {
+            Arc(left, left, right, point, normal, -PI);
+        }
+    }
 
-            if (capSquare) {
-                capEnd = cur + (lineA * halfThick);
-                cur = capEnd;
+    // shorter is the length of the shorter of the two segments, which bounds
+    // how far the inner corner can be moved before it overshoots them.
+    void Join(FPoint2 point, FVector2 a, FVector2 b, float shorter) {
+        float const cross = a.x * b.y - a.y * b.x;
+        float const dot = a.x * b.x + a.y * b.y;
+        FVector2 const na = PolylineNormal(a);
+        FVector2 const nb = PolylineNormal(b);
+
+        // The strip continues straight through collinear points.
+        if (cross == 0.f && dot > 0.f) {
+            if (!started) {
+                FVector2 const normal = na * halfWidth;
+                Advance(Emit(point + normal), Emit(point - normal));
             }
+            return;
+        }
 
-            PolylineExtrusions(output.first, cur, normal.value(), halfThick);
-
-            if (lastFlip == 1) {
-                output.second.push_back(index);
-                output.second.push_back(index + 2);
-                output.second.push_back(index + 3);
+        // Which normal points to the outside of the turn.
+        float const side = cross > 0.f ? -1.f : 1.f;
+
+        // The miter runs along the bisector of the normals; when the line
+        // doubles back on itself there is none, and the join is beveled.
+        FVector2 const bisector = na + nb;
+        float const bisectorLength = bisector.Magnitude();
+        FVector2 const miter
+            = bisectorLength > 0.f ? bisector / bisectorLength : a;
+        float const cosHalf = bisectorLength / 2.f;
+        float const miterLength = cosHalf > 0.f
+            ? halfWidth / cosHalf
+            : std::numeric_limits<float>::infinity();
+
+        float const innerLength = std::min(miterLength,
+            std::sqrt(halfWidth * halfWidth + shorter * shorter));
+        uint32_t const inner = Emit(point - miter * (side * innerLength));
+
+        if (join == LineJoin::Miter && miterLength / halfWidth <= miterLimit) {
+            uint32_t const outer = Emit(point + miter * (side * miterLength));
+            if (side > 0.f) {
+                Advance(outer, inner);
             } else {
-                output.second.push_back(index + 2);
-                output.second.push_back(index + 1);
-                output.second.push_back(index + 3);
+                Advance(inner, outer);
             }
+            return;
+        }
 
-            count += 2;
+        FVector2 const outerA = na * (side * halfWidth);
+        FVector2 const outerB = nb * (side * halfWidth);
+        uint32_t const endA = Emit(point + outerA);
+        if (side > 0.f) {
+            Advance(endA, inner);
         } else {
-            lineB = PolylineDirection(next.value(), cur);
+            Advance(inner, endA);
+        }
 
-            float miterLen
-                = PolylineComputeMiter(tangent, miter, lineA, lineB, halfThick);
+        uint32_t const startB = Emit(point + outerB);
+        if (join == LineJoin::Round) {
+            Arc(inner, endA, startB, point, outerA, std::atan2(cross, dot));
+        } else {
+            Triangle(inner, endA, startB);
+        }
+        left = side > 0.f ? startB : inner;
+        right = side > 0.f ? inner : startB;
+    }
+};
 
-            int flip = ((tangent.x * normal->x) + (tangent.y * normal->y)) < 0
-                ? -1
-                : 1;
+// Strokes every contour, growing vertices and indices only once.
+static void ExpandContours(PolylineExpansion& e, FPoint2 const* points,
+    ContourEnd const* contours, std::size_t numContours,
+    std::vector<FPoint2>& vertices, std::vector<uint32_t>& indices) {
+    std::size_t maxVertices = 0;
+    std::size_t maxIndices = 0;
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < numContours; ++i) {
+        auto const bound = e.Bound(contours[i].end - begin, contours[i].closed);
+        maxVertices += bound.first;
+        maxIndices += bound.second;
+        begin = contours[i].end;
+    }
 
-            bool bevel = joinBevel;
-            if (!bevel && join == LineJoin::Miter) {
-                float limit = miterLen / halfThick;
-                if (limit > miterLimit) bevel = true;
-            }
+    std::size_t const firstVertex = vertices.size();
+    std::size_t const firstIndex = indices.size();
+    vertices.resize(firstVertex + maxVertices);
+    indices.resize(firstIndex + maxIndices);
 
-            if (bevel) {
-                tmp = cur + (normal.value() * (-halfThick * flip));
-                output.first.push_back(tmp);
-                tmp = cur + (miter * (miterLen * flip));
-                output.first.push_back(tmp);
-
-                if (lastFlip != -flip) {
-                    output.second.push_back(index);
-                    output.second.push_back(index + 2);
-                    output.second.push_back(index + 3);
-                } else {
-                    output.second.push_back(index + 2);
-                    output.second.push_back(index + 1);
-                    output.second.push_back(index + 3);
-                }
+    e.vertex = vertices.data() + firstVertex;
+    e.index = indices.data() + firstIndex;
+    e.nextVertex = static_cast<uint32_t>(firstVertex);
 
-                output.second.push_back(index + 2);
-                output.second.push_back(index + 3);
-                output.second.push_back(index + 4);
+    begin = 0;
+    for (std::size_t i = 0; i < numContours; ++i) {
+        e.Build(points + begin, contours[i].end - begin, contours[i].closed);
+        begin = contours[i].end;
+    }
 
-                tmp = PolylineNormal(lineB);
-                normal = tmp;
+    assert(e.vertex <= vertices.data() + vertices.size());
+    assert(e.index <= indices.data() + indices.size());
+    vertices.resize(e.vertex - vertices.data());
+    indices.resize(e.index - indices.data());
+}
 
-                tmp = cur + (tmp * (-halfThick * flip));
-                output.first.push_back(tmp);
+void ExpandStroke(std::vector<FPoint2> const& polygon, const float strokeWidth,
+    const LineCap cap, const LineJoin join, const float miterLimit,
+    const double quality, std::vector<FPoint2>& vertices,
+    std::vector<uint32_t>& indices) {
+    PolylineExpansion e{strokeWidth / 2.f, miterLimit, quality, join, cap};
+    ContourEnd const contour{polygon.size(), false};
+    ExpandContours(e, polygon.data(), &contour, 1, vertices, indices);
+}
 
-                count += 3;
-            } else {
-                PolylineExtrusions(output.first, cur, miter, miterLen);
-
-                if (lastFlip == 1) {
-                    output.second.push_back(index);
-                    output.second.push_back(index + 2);
-                    output.second.push_back(index + 3);
-                } else {
-                    output.second.push_back(index + 2);
-                    output.second.push_back(index + 1);
-                    output.second.push_back(index + 3);
-                }
+void ExpandStroke(std::vector<FPoint2> const& points,
+    std::vector<ContourEnd> const& contourEnds, const float strokeWidth,
+    const LineCap cap, const LineJoin join, const float miterLimit,
+    const double quality, std::vector<FPoint2>& vertices,
+    std::vector<uint32_t>& indices) {
+    PolylineExpansion e{strokeWidth / 2.f, miterLimit, quality, join, cap};
+    ExpandContours(e, points.data(), contourEnds.data(), contourEnds.size(),
+        vertices, indices);
+}
 
-                flip = -1;
+std::pair<std::vector<FPoint2>, std::vector<uint32_t>> ExpandStroke(
+    std::vector<FPoint2> const& polygon, const float strokeWidth,
+    const LineCap cap, const LineJoin join, const float miterLimit,
+    const double quality) {
+    std::pair<std::vector<FPoint2>, std::vector<uint32_t>> output;
+    ExpandStroke(polygon, strokeWidth, cap, join, miterLimit, quality,
+        output.first, output.second);
+    return output;
+}
 
-                normal = miter;
-                count += 2;
+static_assert(sizeof(Vertex) == sizeof(FPoint2),
+    "ExpandPolyline stores vertices as interleaved x/y floats");
+
+// Offset from a polyline point to the left edge of its stroke, given the
+// directions of the segments before and after it. The offset runs along the
+// sum m of the segment normals; its length halfWidth / cos(theta / 2) equals
+// halfWidth * 2 / |m|, so m * (halfWidth * 2 / |m|^2) needs no square root.
+// Zero-length segments have no normal and drop out of both m and the 2.
+static FVector2 PolylineOffset(
+    FVector2 a, FVector2 b, float halfWidth, float minBisector2) {
+    auto const normal = [](FVector2 d) {
+        float const length2 = d.Magnitude2();
+        float const scale = length2 > 0.f ? 1.f / std::sqrt(length2) : 0.f;
+        return FVector2{-d.y * scale, d.x * scale};
+    };
+
+    FVector2 const na = normal(a);
+    FVector2 const nb = normal(b);
+    FVector2 const bisector = na + nb;
+    float const weight = na.Magnitude2() + nb.Magnitude2();
+    return bisector
+        * (halfWidth * weight
+            / std::max(bisector.Magnitude2(), minBisector2));
+}
+
+void ExpandPolyline(FPoint2 const* points, std::size_t count, float strokeWidth,
+    float miterLimit, FVector2 scale, FVector2 offset, Vertex* vertices,
+    uint32_t* indices, uint32_t firstVertex) {
+    if (count < 2) { return; }
+
+    float const halfWidth = strokeWidth / 2.f;
+    // Clamping |m|^2 from below caps the miter at miterLimit * halfWidth.
+    float const minBisector2 = 4.f / (miterLimit * miterLimit);
+
+    auto const emit = [&](std::size_t i, FVector2 a, FVector2 b) {
+        FVector2 const o = PolylineOffset(a, b, halfWidth, minBisector2);
+        vertices[2 * i].position = (points[i] + o) * scale + offset;
+        vertices[2 * i + 1].position = (points[i] - o) * scale + offset;
+    };
+
+    // The ends continue the adjacent segment.
+    emit(0, points[1] - points[0], points[1] - points[0]);
+
+    std::size_t i = 1;
+#if XU_TESSELLATION_SSE2
+    bool const simd = simdKernelsEnabled.load(std::memory_order_relaxed);
+    auto const zero = _mm_setzero_ps();
+    auto const one = _mm_set1_ps(1.f);
+    auto const halfWidthv = _mm_set1_ps(halfWidth);
+    auto const minBisector2v = _mm_set1_ps(minBisector2);
+    auto const scalex = _mm_set1_ps(scale.x);
+    auto const scaley = _mm_set1_ps(scale.y);
+    auto const offsetx = _mm_set1_ps(offset.x);
+    auto const offsety = _mm_set1_ps(offset.y);
+
+    // Splits four interleaved points into their x and y coordinates.
+    auto const load = [](FPoint2 const* p, __m128& x, __m128& y) {
+        auto const lo = _mm_loadu_ps(&p[0].x);
+        auto const hi = _mm_loadu_ps(&p[2].x);
+        x = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        y = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    };
+    // Inverse length, or zero for zero-length vectors.
+    auto const inverseLength = [&](__m128 x, __m128 y) {
+        auto const length2 = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+        return _mm_and_ps(_mm_cmpgt_ps(length2, zero),
+            _mm_div_ps(one, _mm_sqrt_ps(length2)));
+    };
+    auto const transform = [](__m128 v, __m128 scale, __m128 offset) {
+        return _mm_add_ps(_mm_mul_ps(v, scale), offset);
+    };
+
+    // Four interior points at a time; each also needs the point after it.
+    for (; simd && i + 4 < count; i += 4) {
+        __m128 px, py, cx, cy, nx, ny;
+        load(points + i - 1, px, py);
+        load(points + i, cx, cy);
+        load(points + i + 1, nx, ny);
+
+        auto const ax = _mm_sub_ps(cx, px);
+        auto const ay = _mm_sub_ps(cy, py);
+        auto const bx = _mm_sub_ps(nx, cx);
+        auto const by = _mm_sub_ps(ny, cy);
+        auto const ia = inverseLength(ax, ay);
+        auto const ib = inverseLength(bx, by);
+
+        // Normals (-y, x); the negation is folded into the sums below.
+        auto const nay = _mm_mul_ps(ax, ia);
+        auto const nax = _mm_mul_ps(ay, ia);
+        auto const nby = _mm_mul_ps(bx, ib);
+        auto const nbx = _mm_mul_ps(by, ib);
+
+        auto const mx = _mm_sub_ps(zero, _mm_add_ps(nax, nbx));
+        auto const my = _mm_add_ps(nay, nby);
+        auto const weight = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(nax, nax), _mm_mul_ps(nay, nay)),
+            _mm_add_ps(_mm_mul_ps(nbx, nbx), _mm_mul_ps(nby, nby)));
+        auto const m2 = _mm_max_ps(
+            _mm_add_ps(_mm_mul_ps(mx, mx), _mm_mul_ps(my, my)), minBisector2v);
+        auto const f = _mm_div_ps(_mm_mul_ps(halfWidthv, weight), m2);
+        auto const ox = _mm_mul_ps(mx, f);
+        auto const oy = _mm_mul_ps(my, f);
+
+        auto const lx = transform(_mm_add_ps(cx, ox), scalex, offsetx);
+        auto const ly = transform(_mm_add_ps(cy, oy), scaley, offsety);
+        auto const rx = transform(_mm_sub_ps(cx, ox), scalex, offsetx);
+        auto const ry = transform(_mm_sub_ps(cy, oy), scaley, offsety);
+
+        // Left and right vertex of each point are adjacent.
+        float* dst = &vertices[2 * i].position.x;
+        auto const l01 = _mm_unpacklo_ps(lx, ly);
+        auto const r01 = _mm_unpacklo_ps(rx, ry);
+        auto const l23 = _mm_unpackhi_ps(lx, ly);
+        auto const r23 = _mm_unpackhi_ps(rx, ry);
+        _mm_storeu_ps(dst, _mm_movelh_ps(l01, r01));
+        _mm_storeu_ps(dst + 4, _mm_movehl_ps(r01, l01));
+        _mm_storeu_ps(dst + 8, _mm_movelh_ps(l23, r23));
+        _mm_storeu_ps(dst + 12, _mm_movehl_ps(r23, l23));
+    }
+#endif
+    for (; i + 1 < count; ++i) {
+        emit(i, points[i] - points[i - 1], points[i + 1] - points[i]);
+    }
+
+    emit(count - 1, points[count - 1] - points[count - 2],
+        points[count - 1] - points[count - 2]);
+
+    for (std::size_t segment = 0; segment + 1 < count; ++segment) {
+        auto const left = firstVertex + static_cast<uint32_t>(2 * segment);
+        indices[0] = left;
+        indices[1] = left + 1;
+        indices[2] = left + 2;
+        indices[3] = left + 2;
+        indices[4] = left + 1;
+        indices[5] = left + 3;
+        indices += 6;
+    }
+}
+
+static float Cross(FPoint2 a, FPoint2 b, FPoint2 c) {
+    return (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+}
+
+// Counts how often the sign of a coordinate delta changes around a closed
+// polygon, ignoring zero deltas. A simple convex polygon changes at most twice
+// per axis; polygons winding around more than once change more often.
+struct DirectionChanges {
+    int first = 0;
+    int last = 0;
+    int changes = 0;
+
+    void Add(float delta) {
+        int const sign = (delta > 0.f) - (delta < 0.f);
+        if (sign == 0) { return; }
+        if (first == 0) { first = sign; }
+        if (last != 0 && sign != last) { ++changes; }
+        last = sign;
+    }
+
+    int Total() const { return changes + (last != 0 && last != first); }
+};
+
+// Whether a and b differ only by rounding, e.g. where a flattened arc ends one
+// ulp away from where it started.
+static bool NearlyEqual(FPoint2 a, FPoint2 b) {
+    auto const near = [](float p, float q) {
+        float const scale = std::max({1.f, std::abs(p), std::abs(q)});
+        return std::abs(p - q)
+            <= 16.f * std::numeric_limits<float>::epsilon() * scale;
+    };
+    return near(a.x, b.x) && near(a.y, b.y);
+}
+
+// Triangulates the polygon as a fan if it is convex; returns false otherwise.
+// Collinear vertices are skipped, so e.g. a rectangle whose closing point
+// repeats its first one yields exactly two triangles.
+static bool TriangulateConvex(FPoint2 const* points, std::size_t n,
+    uint32_t base, std::vector<uint32_t>& indices) {
+    // A duplicated closing point is not part of the fan. Closing points that
+    // are only nearly equal count too; the tiny edge they would add points
+    // in an arbitrary direction and would reject e.g. every circle.
+    while (n > 1 && NearlyEqual(points[n - 1], points[0])) { --n; }
+    if (n < 3) { return true; }
+
+    // Walks every corner b, between the edges a-b and b-c, once. Indices wrap
+    // by comparison rather than modulo, which dominated for small polygons.
+    int winding = 0;
+    DirectionChanges dx;
+    DirectionChanges dy;
+    FPoint2 a = points[n - 2];
+    FPoint2 b = points[n - 1];
+    for (std::size_t i = 0; i < n; ++i) {
+        FPoint2 const c = points[i];
+
+        float const cross = Cross(a, b, c);
+        int const sign = (cross > 0.f) - (cross < 0.f);
+        if (sign != 0) {
+            if (winding == 0) {
+                winding = sign;
+            } else if (sign != winding) {
+                return false;
             }
-            lastFlip = flip;
         }
 
-        return count;
+        dx.Add(c.x - b.x);
+        dy.Add(c.y - b.y);
+        a = b;
+        b = c;
     }
-};
+    if (dx.Total() > 2 || dy.Total() > 2) { return false; }
+    // All points on a line; nothing to fill.
+    if (winding == 0) { return true; }
+
+    auto const isCorner = [&](std::size_t i) {
+        return Cross(points[i == 0 ? n - 1 : i - 1], points[i],
+                   points[i + 1 == n ? 0 : i + 1])
+            != 0.f;
+    };
+
+    std::size_t pivot = 0;
+    while (!isCorner(pivot)) { ++pivot; }
+
+    std::size_t previous = pivot;
+    for (std::size_t k = 1; k < n; ++k) {
+        std::size_t const i = pivot + k < n ? pivot + k : pivot + k - n;
+        if (!isCorner(i)) { continue; }
+        if (previous != pivot) {
+            indices.push_back(base + static_cast<uint32_t>(pivot));
+            indices.push_back(base + static_cast<uint32_t>(previous));
+            indices.push_back(base + static_cast<uint32_t>(i));
+        }
+        previous = i;
+    }
+    return true;
+}
 
-// Taken from:
-// https://github.com/mattdesl/extrude-polyline
-std::pair<std::vector<FPoint2>, std::vector<uint32_t>> ExpandStroke(
-    std::vector<FPoint2> const& polygon, const float strokeWidth,
-    const LineCap cap, const LineJoin join, const float miterLimit,
-    const double quality) {
-    PolylineExpansion e;
-    e.miterLimit = miterLimit;
-    e.thickness = strokeWidth;
-    e.join = join;
-    e.cap = cap;
-    return e.Build(polygon);
+// Triangulates rings[0] with the other rings as holes in it. All rings view
+// into the same buffer, and indices refer to origin[0].
+static void EarcutRings(FPoint2 const* origin,
+    std::vector<PolygonRing> const& rings, std::vector<uint32_t>& indices) {
+    // One instance per thread so its index vector keeps its capacity between
+    // calls. Its node pool does not: Earcut::operator() frees the pool's
+    // blocks on every call.
+    thread_local mapbox::detail::Earcut<uint32_t> earcut;
+    thread_local std::vector<uint32_t> remap;
+
+    earcut(rings);
+
+    // Earcut numbers the points of all rings consecutively.
+    remap.clear();
+    for (auto const& ring : rings) {
+        auto const base = static_cast<uint32_t>(ring.points - origin);
+        for (std::size_t i = 0; i < ring.count; ++i) {
+            remap.push_back(base + static_cast<uint32_t>(i));
+        }
+    }
+
+    for (uint32_t const index : earcut.indices) {
+        indices.push_back(remap[index]);
+    }
 }
 
-std::vector<uint32_t> Triangulate(std::vector<FPoint2> const& polygon) {
-    if (polygon.size() <= 2) { return {}; }
+static void TriangulatePolygon(FPoint2 const* origin, std::size_t begin,
+    std::size_t count, std::vector<uint32_t>& indices) {
+    if (count <= 2) { return; }
+
+    // Nearly all UI fills (rectangles, round rectangles, circles) are convex
+    // and need no ear clipping.
+    if (TriangulateConvex(
+            origin + begin, count, static_cast<uint32_t>(begin), indices)) {
+        return;
+    }
+
+    thread_local std::vector<PolygonRing> rings;
+    rings.assign(1, PolygonRing{origin + begin, count});
+    EarcutRings(origin, rings, indices);
+}
+
+void Triangulate(
+    std::vector<FPoint2> const& polygon, std::vector<uint32_t>& indices) {
+    TriangulatePolygon(polygon.data(), 0, polygon.size(), indices);
+}
+
+static float SignedArea(FPoint2 const* points, std::size_t n) {
+    float area = 0.f;
+    for (std::size_t i = 0, j = n - 1; i < n; j = i++) {
+        area += points[j].x * points[i].y - points[i].x * points[j].y;
+    }
+    return area / 2.f;
+}
+
+// Winding number of the closed polygon around point; positive for polygons
+// with a positive SignedArea().
+static int WindingNumber(FPoint2 const* points, std::size_t n, FPoint2 point) {
+    int winding = 0;
+    for (std::size_t i = 0, j = n - 1; i < n; j = i++) {
+        FPoint2 const a = points[j];
+        FPoint2 const b = points[i];
+        float const side
+            = (b.x - a.x) * (point.y - a.y) - (point.x - a.x) * (b.y - a.y);
+        if (a.y <= point.y) {
+            if (b.y > point.y && side > 0.f) { ++winding; }
+        } else if (b.y <= point.y && side < 0.f) {
+            --winding;
+        }
+    }
+    return winding;
+}
+
+// A contour of a path being filled.
+struct Contour {
+    std::size_t begin;
+    std::size_t count;
+    float area;
+    enum class Kind { Outline, Hole, Ignored } kind;
+    // For holes, the outline they are cut from.
+    std::size_t parent;
+};
+
+void Triangulate(std::vector<FPoint2> const& points,
+    std::vector<ContourEnd> const& contourEnds, FillRule fillRule,
+    std::vector<uint32_t>& indices) {
+    if (contourEnds.size() <= 1) {
+        TriangulatePolygon(points.data(), 0,
+            contourEnds.empty() ? 0 : contourEnds.front().end, indices);
+        return;
+    }
 
-    using Point = std::array<float, 2>;
-    std::vector<std::vector<Point>> x{{}};
-    x[0].resize(polygon.size());
-    for (std::size_t i = 0; i < polygon.size(); ++i) {
-        x[0][i] = {polygon[i].x, polygon[i].y};
+    FPoint2 const* const origin = points.data();
+
+    thread_local std::vector<Contour> contours;
+    contours.clear();
+    std::size_t begin = 0;
+    for (auto const& contourEnd : contourEnds) {
+        std::size_t const end = contourEnd.end;
+        std::size_t count = end - begin;
+        while (count > 1 && origin[begin + count - 1] == origin[begin]) {
+            --count;
+        }
+
+        float const area
+            = count >= 3 ? SignedArea(origin + begin, count) : 0.f;
+        contours.push_back({begin, count, area,
+            area == 0.f ? Contour::Kind::Ignored : Contour::Kind::Outline, 0});
+        begin = end;
     }
-    return mapbox::earcut<uint32_t>(x);
+
+    // Whether a contour is an outline or a hole depends on how the others
+    // wind around it. Contours must not cross, so testing a single point of
+    // each is enough.
+    for (auto& contour : contours) {
+        if (contour.kind == Contour::Kind::Ignored) { continue; }
+
+        FPoint2 const point = origin[contour.begin];
+        int winding = 0;
+        int enclosing = 0;
+        for (auto const& other : contours) {
+            if (&other == &contour || other.area == 0.f) { continue; }
+            int const w
+                = WindingNumber(origin + other.begin, other.count, point);
+            winding += w;
+            enclosing += w & 1;
+        }
+
+        if (fillRule == FillRule::EvenOdd) {
+            if (enclosing % 2 == 1) { contour.kind = Contour::Kind::Hole; }
+        } else {
+            int const inside = winding + (contour.area > 0.f ? 1 : -1);
+            if (winding != 0 && inside == 0) {
+                contour.kind = Contour::Kind::Hole;
+            } else if (winding != 0) {
+                // Filled on both sides, so it bounds nothing.
+                contour.kind = Contour::Kind::Ignored;
+            }
+        }
+    }
+
+    // Each hole is cut from the smallest outline around it.
+    for (auto& hole : contours) {
+        if (hole.kind != Contour::Kind::Hole) { continue; }
+
+        FPoint2 const point = origin[hole.begin];
+        float parentArea = 0.f;
+        for (std::size_t i = 0; i < contours.size(); ++i) {
+            auto const& outline = contours[i];
+            float const area = std::abs(outline.area);
+            if (outline.kind != Contour::Kind::Outline
+                || (parentArea != 0.f && area >= parentArea)
+                || WindingNumber(
+                       origin + outline.begin, outline.count, point)
+                    == 0) {
+                continue;
+            }
+            hole.parent = i;
+            parentArea = area;
+        }
+        if (parentArea == 0.f) { hole.kind = Contour::Kind::Ignored; }
+    }
+
+    thread_local std::vector<PolygonRing> rings;
+    for (std::size_t i = 0; i < contours.size(); ++i) {
+        auto const& outline = contours[i];
+        if (outline.kind != Contour::Kind::Outline) { continue; }
+
+        rings.assign(1, PolygonRing{origin + outline.begin, outline.count});
+        for (auto const& hole : contours) {
+            if (hole.kind == Contour::Kind::Hole && hole.parent == i) {
+                rings.push_back(PolygonRing{origin + hole.begin, hole.count});
+            }
+        }
+
+        if (rings.size() == 1) {
+            TriangulatePolygon(origin, outline.begin, outline.count, indices);
+        } else {
+            EarcutRings(origin, rings, indices);
+        }
+    }
+}
+
+std::vector<uint32_t> Triangulate(std::vector<FPoint2> const& polygon) {
+    std::vector<uint32_t> indices;
+    Triangulate(polygon, indices);
+    return indices;
 }
 
 } // namespace xu
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <xu/core/Point2.hpp>
+#include <xu/core/RenderData.hpp>
 #include <xu/core/VectorPath.hpp>
 #include <xu/core/Definitions.hpp>
 
@@ -44,6 +45,25 @@ namespace xu {
 // path flattening should be. If it is too low, the final path will appear
 // jagged and low quality.
 std::vector<FPoint2> FlattenPath(VectorPath const& path, double quality);
+// Same as above, but appends the points to out, so a buffer can be reused
+// across calls without allocating.
+void FlattenPath(
+    VectorPath const& path, double quality, std::vector<FPoint2>& out);
+
+// Where a contour of a flattened path ends.
+struct ContourEnd {
+    // Offset one past the contour's last point.
+    std::size_t end;
+    // Whether the contour was ended by a Close event, in which case its last
+    // point repeats its first one.
+    bool closed;
+};
+
+// Same as above, but also appends the end of each contour of the path to
+// contourEnds. Move and Close events end a contour; contours without points
+// are left out.
+void FlattenPath(VectorPath const& path, double quality,
+    std::vector<FPoint2>& out, std::vector<ContourEnd>& contourEnds);
 
 // This is an optional step in the vector path triangulation process; right
 // after flattening.
@@ -55,18 +75,57 @@ std::vector<FPoint2> FlattenPath(VectorPath const& path, double quality);
 //
 // strokeWidth is the thickness of the stroke.
 // cap is how the end of lines should appear.
-// quality only applies to LineCap::Round and controls how smooth the rounded
-// cap should appear.
+// join is how corners should appear; a miter is beveled instead once it is
+// longer than miterLimit times half the stroke width.
+// quality only applies to LineCap::Round and LineJoin::Round and controls how
+// smooth the rounded caps and joins should appear.
 //
 // Also, this should be the final step since it also generates indices during
 // stroke expansion.
 std::pair<std::vector<FPoint2>, std::vector<uint32_t>> ExpandStroke(
     std::vector<FPoint2> const& polygon, float strokeWidth, LineCap cap,
     LineJoin join, float miterLimit, double quality);
+// Same as above, but appends to vertices and indices. Indices refer to
+// vertices[0], i.e. they include any vertices that were already present.
+void ExpandStroke(std::vector<FPoint2> const& polygon, float strokeWidth,
+    LineCap cap, LineJoin join, float miterLimit, double quality,
+    std::vector<FPoint2>& vertices, std::vector<uint32_t>& indices);
+// Same as above, but strokes every contour of points separately. The contours
+// are laid out as FlattenPath() describes them, starting at points[0]. Closed
+// contours are joined where they start instead of getting caps.
+void ExpandStroke(std::vector<FPoint2> const& points,
+    std::vector<ContourEnd> const& contourEnds, float strokeWidth,
+    LineCap cap, LineJoin join, float miterLimit, double quality,
+    std::vector<FPoint2>& vertices, std::vector<uint32_t>& indices);
+
+// A lighter alternative to flattening and stroking a path, for polylines with
+// many points (e.g. charts).
+//
+// Every point becomes two vertices, left and right of the line, written to
+// vertices[2 * i] and vertices[2 * i + 1]; every segment becomes two triangles
+// whose 6 indices are written to indices[6 * i], counting from firstVertex.
+// Corners are mitered, with miters clamped to miterLimit times half the
+// stroke width; there are no caps. Each vertex p is written as
+// p * scale + offset.
+//
+// Nothing is written for fewer than two points.
+void ExpandPolyline(FPoint2 const* points, std::size_t count, float strokeWidth,
+    float miterLimit, FVector2 scale, FVector2 offset, Vertex* vertices,
+    uint32_t* indices, uint32_t firstVertex);
+
+// FlattenPath() and ExpandPolyline() use SSE2 kernels where the target has
+// SSE2; SimdKernelsAvailable() tells whether it does. The scalar kernels give
+// bit-identical output (as long as the compiler does not contract them into
+// fused multiply-adds), so this switch only exists to compare the two in
+// tests and benchmarks. Enabled by default.
+void SetSimdKernelsEnabled(bool enabled);
+bool SimdKernelsAvailable();
 
 // This is the final step in the vector path triangulation process.
 //
 // It uses a triangulation algorithm which will return a list of indices.
+// Convex polygons (rectangles, round rectangles, circles) are fanned directly;
+// anything else goes through ear clipping.
 //
 // After invoking this, you should now have;
 // - a list of points
@@ -75,5 +134,15 @@ std::pair<std::vector<FPoint2>, std::vector<uint32_t>> ExpandStroke(
 // Now you put the points in your vertex type and upload to a vertex buffer, and
 // upload the indices to an index buffer; then render. :)
 std::vector<uint32_t> Triangulate(std::vector<FPoint2> const& polygon);
+// Same as above, but appends the indices to indices.
+void Triangulate(
+    std::vector<FPoint2> const& polygon, std::vector<uint32_t>& indices);
+// Same as above, but triangulates several contours at once, laid out as
+// FlattenPath() describes them starting at points[0]. Nested contours become
+// holes or islands according to fillRule, so a ring or a shape with cutouts
+// comes out as a single mesh without overlapping triangles.
+void Triangulate(std::vector<FPoint2> const& points,
+    std::vector<ContourEnd> const& contourEnds, FillRule fillRule,
+    std::vector<uint32_t>& indices);
 
 } // namespace xu
@@ -0,0 +1,233 @@
+// MIT License
+//
+// Copyright (c) 2020 Xu Collaborators
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <xu/core/TessellationCache.hpp>
+
+#include <functional>
+
+namespace xu {
+
+static void HashCombine(std::size_t& seed, std::size_t value) {
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+static void HashPoint(std::size_t& seed, FPoint2 const& point) {
+    HashCombine(seed, std::hash<float>{}(point.x));
+    HashCombine(seed, std::hash<float>{}(point.y));
+}
+
+static bool EventsEqual(
+    VectorPathEvent const& lhs, VectorPathEvent const& rhs) {
+    if (lhs.type != rhs.type) { return false; }
+
+    // Only the active member of the union is compared.
+    auto const& l = lhs.params;
+    auto const& r = rhs.params;
+    switch (lhs.type) {
+        case VectorPathEventType::Line: return l.line.to == r.line.to;
+        case VectorPathEventType::Quadratic:
+            return l.quadratic.to == r.quadratic.to
+                && l.quadratic.x0 == r.quadratic.x0;
+        case VectorPathEventType::Cubic:
+            return l.cubic.to == r.cubic.to && l.cubic.x0 == r.cubic.x0
+                && l.cubic.x1 == r.cubic.x1;
+        case VectorPathEventType::Arc:
+            return l.arc.center == r.arc.center && l.arc.radius == r.arc.radius
+                && l.arc.startAngle == r.arc.startAngle
+                && l.arc.endAngle == r.arc.endAngle;
+        case VectorPathEventType::Move: return l.move.to == r.move.to;
+        case VectorPathEventType::Close: return true;
+    }
+    return false;
+}
+
+static void HashEvent(std::size_t& seed, VectorPathEvent const& evt) {
+    HashCombine(seed, static_cast<std::size_t>(evt.type));
+
+    auto const& p = evt.params;
+    switch (evt.type) {
+        case VectorPathEventType::Line: HashPoint(seed, p.line.to); break;
+        case VectorPathEventType::Quadratic:
+            HashPoint(seed, p.quadratic.to);
+            HashPoint(seed, p.quadratic.x0);
+            break;
+        case VectorPathEventType::Cubic:
+            HashPoint(seed, p.cubic.to);
+            HashPoint(seed, p.cubic.x0);
+            HashPoint(seed, p.cubic.x1);
+            break;
+        case VectorPathEventType::Arc:
+            HashPoint(seed, p.arc.center);
+            HashCombine(seed, std::hash<float>{}(p.arc.radius));
+            HashCombine(seed, std::hash<float>{}(p.arc.startAngle));
+            HashCombine(seed, std::hash<float>{}(p.arc.endAngle));
+            break;
+        case VectorPathEventType::Move: HashPoint(seed, p.move.to); break;
+        case VectorPathEventType::Close: break;
+    }
+}
+
+bool TessellationCache::KeyEqual::operator()(
+    KeyView const& lhs, KeyView const& rhs) const {
+    if (lhs.hash != rhs.hash || lhs.stroke != rhs.stroke
+        || lhs.quality != rhs.quality || lhs.strokeWidth != rhs.strokeWidth
+        || lhs.cap != rhs.cap || lhs.join != rhs.join
+        || lhs.miterLimit != rhs.miterLimit || lhs.fillRule != rhs.fillRule
+        || lhs.start != rhs.start
+        || lhs.numEvents != rhs.numEvents) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < lhs.numEvents; ++i) {
+        if (!EventsEqual(lhs.events[i], rhs.events[i])) { return false; }
+    }
+    return true;
+}
+
+TessellationCache::TessellationCache(std::size_t capacity) :
+    capacity{capacity} {}
+
+SharedBakedVectorPath TessellationCache::BakeFill(
+    VectorPath const& path, double quality) {
+    KeyView const key = MakeKey(
+        path, false, quality, 0.f, LineCap::Butt, LineJoin::Miter, 0.f);
+    if (auto cached = Find(key)) { return cached; }
+
+    // Tessellate without holding the lock so other threads are not blocked.
+    return Insert(
+        key, std::make_shared<BakedVectorPath const>(path.BakeFill(quality)));
+}
+
+SharedBakedVectorPath TessellationCache::BakeStroke(VectorPath const& path,
+    double quality, float strokeWidth, LineCap cap, LineJoin join,
+    float miterLimit) {
+    KeyView const key = MakeKey(
+        path, true, quality, strokeWidth, cap, join, miterLimit);
+    if (auto cached = Find(key)) { return cached; }
+
+    return Insert(key,
+        std::make_shared<BakedVectorPath const>(
+            path.BakeStroke(quality, strokeWidth, cap, join, miterLimit)));
+}
+
+void TessellationCache::SetCapacity(std::size_t capacity) {
+    std::lock_guard<std::mutex> lock{mutex};
+    this->capacity = capacity;
+    EvictToCapacity();
+}
+
+std::size_t TessellationCache::Capacity() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return capacity;
+}
+
+void TessellationCache::Clear() {
+    std::lock_guard<std::mutex> lock{mutex};
+    index.clear();
+    entries.clear();
+    stats.entries = 0;
+}
+
+TessellationCacheStats TessellationCache::GetStats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return stats;
+}
+
+TessellationCache::KeyView TessellationCache::MakeKey(VectorPath const& path,
+    bool stroke, double quality, float strokeWidth, LineCap cap, LineJoin join,
+    float miterLimit) {
+    KeyView key;
+    key.stroke = stroke;
+    key.quality = quality;
+    key.strokeWidth = strokeWidth;
+    key.cap = cap;
+    key.join = join;
+    key.miterLimit = miterLimit;
+    // Strokes do not depend on the fill rule, so they share entries.
+    key.fillRule = stroke ? FillRule::NonZero : path.fillRule;
+    key.start = path.start;
+    key.events = path.events.data();
+    key.numEvents = path.events.size();
+    key.hash = HashKey(key);
+    return key;
+}
+
+std::size_t TessellationCache::HashKey(KeyView const& key) {
+    std::size_t seed = key.stroke;
+    HashCombine(seed, std::hash<double>{}(key.quality));
+    HashCombine(seed, std::hash<float>{}(key.strokeWidth));
+    HashCombine(seed, static_cast<std::size_t>(key.cap));
+    HashCombine(seed, static_cast<std::size_t>(key.join));
+    HashCombine(seed, std::hash<float>{}(key.miterLimit));
+    HashCombine(seed, static_cast<std::size_t>(key.fillRule));
+    HashPoint(seed, key.start);
+    for (std::size_t i = 0; i < key.numEvents; ++i) {
+        HashEvent(seed, key.events[i]);
+    }
+    return seed;
+}
+
+SharedBakedVectorPath TessellationCache::Find(KeyView const& key) {
+    std::lock_guard<std::mutex> lock{mutex};
+    auto const it = index.find(key);
+    if (it == index.end()) {
+        ++stats.misses;
+        return nullptr;
+    }
+
+    ++stats.hits;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->path;
+}
+
+SharedBakedVectorPath TessellationCache::Insert(
+    KeyView const& key, SharedBakedVectorPath path) {
+    std::lock_guard<std::mutex> lock{mutex};
+    if (capacity == 0) { return path; }
+
+    // Another thread may have baked the same path in the meantime.
+    if (auto const it = index.find(key); it != index.end()) {
+        return it->second->path;
+    }
+
+    Entry& entry = entries.emplace_front();
+    entry.events.assign(key.events, key.events + key.numEvents);
+    entry.key = key;
+    entry.key.events = entry.events.data();
+    entry.path = std::move(path);
+    index.emplace(entry.key, entries.begin());
+    stats.entries = entries.size();
+
+    EvictToCapacity();
+    return entries.front().path;
+}
+
+void TessellationCache::EvictToCapacity() {
+    while (entries.size() > capacity) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+        ++stats.evictions;
+    }
+    stats.entries = entries.size();
+}
+
+} // namespace xu
@@ -62,6 +62,19 @@ VectorPathEvent VectorPathEvent::Arc(
     return evt;
 }
 
+VectorPathEvent VectorPathEvent::Move(FPoint2 to) {
+    VectorPathEvent evt;
+    evt.type = VectorPathEventType::Move;
+    evt.params.move.to = to;
+    return evt;
+}
+
+VectorPathEvent VectorPathEvent::Close() {
+    VectorPathEvent evt;
+    evt.type = VectorPathEventType::Close;
+    return evt;
+}
+
 BakedVectorPath BakedVectorPath::WithOffset(FVector2 const offset) const {
     auto newVerts = vertices;
     for (auto& vert : newVerts) { vert += offset; }
@@ -78,7 +91,7 @@ VectorPath VectorPath::Rectangle(FSize2 const size) {
     VectorPath out;
     out.events = {VectorPathEvent::Line({size.x, 0.f}),
         VectorPathEvent::Line(size), VectorPathEvent::Line({0.f, size.y}),
-        VectorPathEvent::Line({0.f, 0.f})};
+        VectorPathEvent::Line({0.f, 0.f}), VectorPathEvent::Close()};
     return out;
 }
 
@@ -100,7 +113,7 @@ VectorPath VectorPath::RoundRectangle(
         VectorPathEvent::Line({cornerRadii[3], size.y}),
         VectorPathEvent::Arc({cornerRadii[3], size.y - cornerRadii[3]},
             cornerRadii[3], 0.5 * PI, PI),
-        VectorPathEvent::Line({0.f, cornerRadii[0]})};
+        VectorPathEvent::Line({0.f, cornerRadii[0]}), VectorPathEvent::Close()};
 
     return out;
 }
@@ -112,16 +125,42 @@ VectorPath VectorPath::RoundRectangle(
 }
 
 BakedVectorPath VectorPath::BakeFill(double quality) const {
-    const auto vertices = FlattenPath(*this, quality);
-    return BakedVectorPath{vertices, Triangulate(vertices)};
+    BakedVectorPath out;
+    BakeFill(out, quality);
+    return out;
 }
 
 BakedVectorPath VectorPath::BakeStroke(double quality, float strokeWidth,
     LineCap cap, LineJoin join, float miterLimit) const {
-    const auto flattened = FlattenPath(*this, quality);
-    const auto [vertices, indices]
-        = ExpandStroke(flattened, strokeWidth, cap, join, miterLimit, quality);
-    return BakedVectorPath{vertices, indices};
+    BakedVectorPath out;
+    std::vector<FPoint2> scratch;
+    BakeStroke(out, scratch, quality, strokeWidth, cap, join, miterLimit);
+    return out;
+}
+
+// Contour boundaries of the path being baked; kept per thread so rebaking does
+// not allocate.
+static thread_local std::vector<ContourEnd> contourEnds;
+
+void VectorPath::BakeFill(BakedVectorPath& out, double quality) const {
+    out.vertices.clear();
+    out.indices.clear();
+    contourEnds.clear();
+    FlattenPath(*this, quality, out.vertices, contourEnds);
+    Triangulate(out.vertices, contourEnds, fillRule, out.indices);
+}
+
+void VectorPath::BakeStroke(BakedVectorPath& out,
+    std::vector<FPoint2>& scratch, double quality, float strokeWidth,
+    LineCap cap, LineJoin join, float miterLimit) const {
+    scratch.clear();
+    contourEnds.clear();
+    FlattenPath(*this, quality, scratch, contourEnds);
+
+    out.vertices.clear();
+    out.indices.clear();
+    ExpandStroke(scratch, contourEnds, strokeWidth, cap, join, miterLimit,
+        quality, out.vertices, out.indices);
 }
 
 } // namespace xu
@@ -22,23 +22,36 @@
 
 #include <xu/core/Widget.hpp>
 #include <xu/core/WidgetPtr.hpp>
+#include <xu/core/Context.hpp>
 
 namespace xu {
 
 Widget::Widget(Widget* parent, Context* context) :
     hidden{false},
+    dirty{false},
+    descendantDirty{false},
+    painted{false},
+    hitTestDirty{false},
     geometry{{0.0f, 0.0f}, {0.0f, 0.0f}},
     ownedLayout{nullptr},
     parentLayout{nullptr},
     layoutItem{nullptr},
     horizontalShb{SizeHintBehaviour::Preferred},
     verticalShb{SizeHintBehaviour::Preferred},
-    parent{parent} {}
+    context{context},
+    parent{parent} {
+    MarkDirty();
+    InvalidateHitTest();
+}
 
 Widget::Widget(Widget* parent) : Widget{parent, parent->context} {}
 Widget::Widget(Context& context) : Widget{nullptr, &context} {}
 
-Widget::~Widget() { sigBeforeDestruction(); }
+Widget::~Widget() {
+    sigBeforeDestruction();
+    if (parent) { parent->InvalidateHitTest(); }
+    context->ForgetWidget(this);
+}
 
 void Widget::Paint(Surface& surf, Theme& theme) const {}
 
@@ -49,13 +62,39 @@ bool Widget::PointerHit(FPoint2 const& pointer) const {
 }
 
 void Widget::SetGeometry(FRect2 const& geometry) {
-    this->geometry = geometry;
+    if (this->geometry != geometry) {
+        this->geometry = geometry;
+        MarkDirty();
+        InvalidateHitTest();
+    }
 
     if (layoutItem) { layoutItem->Apply(); }
 }
 
 FRect2 Widget::Geometry() const { return geometry; }
 
+void Widget::SetHidden(bool hidden) {
+    if (this->hidden == hidden) { return; }
+    this->hidden = hidden;
+    MarkDirty();
+    InvalidateHitTest();
+}
+
+bool Widget::Hidden() const { return hidden; }
+
+void Widget::InvalidateHitTest() {
+    Widget* root = this;
+    while (root->parent) { root = root->parent; }
+    root->hitTestDirty = true;
+}
+
+void Widget::MarkDirty() {
+    dirty = true;
+    for (Widget* ancestor = parent; ancestor; ancestor = ancestor->parent) {
+        ancestor->descendantDirty = true;
+    }
+}
+
 Widget* Widget::Parent() const { return parent; }
 
 Context& Widget::GetContext() const { return *context; }
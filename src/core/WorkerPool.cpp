@@ -0,0 +1,98 @@
+// MIT License
+//
+// Copyright (c) 2020 Xu Collaborators
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "WorkerPool.hpp"
+
+#include <utility>
+
+namespace xu {
+
+WorkerPool::WorkerPool(std::size_t threadCount) {
+    threads.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back([this] { WorkerMain(); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) { thread.join(); }
+}
+
+void WorkerPool::Run(std::size_t count, Job job, void* data) {
+    if (count == 0) { return; }
+
+    std::unique_lock<std::mutex> lock{mutex};
+    this->job = job;
+    jobData = data;
+    next = 0;
+    this->count = count;
+    pending = count;
+    error = nullptr;
+    ++generation;
+    wake.notify_all();
+
+    Work(lock);
+    done.wait(lock, [this] { return pending == 0; });
+
+    this->job = nullptr;
+    jobData = nullptr;
+    if (error) { std::rethrow_exception(std::exchange(error, nullptr)); }
+}
+
+void WorkerPool::WorkerMain() {
+    std::unique_lock<std::mutex> lock{mutex};
+    uint64_t seen = generation;
+    for (;;) {
+        wake.wait(lock, [&] { return stop || generation != seen; });
+        if (stop) { return; }
+
+        seen = generation;
+        Work(lock);
+    }
+}
+
+void WorkerPool::Work(std::unique_lock<std::mutex>& lock) {
+    // Iterations are coarse (a whole window each), so handing them out under
+    // the lock costs nothing noticeable.
+    while (next < count) {
+        std::size_t const i = next++;
+        Job const currentJob = job;
+        void* const data = jobData;
+
+        lock.unlock();
+        std::exception_ptr thrown;
+        try {
+            currentJob(data, i);
+        } catch (...) { thrown = std::current_exception(); }
+        lock.lock();
+
+        if (thrown && !error) { error = thrown; }
+        if (--pending == 0) { done.notify_all(); }
+    }
+}
+
+} // namespace xu
@@ -0,0 +1,84 @@
+// MIT License
+//
+// Copyright (c) 2020 Xu Collaborators
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <xu/core/Definitions.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xu {
+
+// Fixed set of threads that run the iterations of a parallel loop. The calling
+// thread takes part in the loop too, so a pool of N threads runs on up to N + 1
+// cores. Only one loop runs at a time; ParallelFor() must not be called from
+// inside a loop body.
+class WorkerPool final {
+public:
+    explicit WorkerPool(std::size_t threadCount);
+    ~WorkerPool();
+
+    WorkerPool(WorkerPool const&) = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+
+    std::size_t ThreadCount() const { return threads.size(); }
+
+    // Calls fn(i) for every i in [0, count) and returns once all calls are
+    // done. The first exception thrown by fn is rethrown here.
+    template<typename F>
+    void ParallelFor(std::size_t count, F&& fn) {
+        Run(count,
+            [](void* data, std::size_t i) { (*static_cast<F*>(data))(i); },
+            &fn);
+    }
+
+private:
+    using Job = void (*)(void* data, std::size_t i);
+
+    void Run(std::size_t count, Job job, void* data);
+    void WorkerMain();
+    // Runs iterations until none are left. Called with the lock held.
+    void Work(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    // State of the current loop, guarded by mutex.
+    Job job = nullptr;
+    void* jobData = nullptr;
+    std::size_t next = 0;
+    std::size_t count = 0;
+    std::size_t pending = 0;
+    uint64_t generation = 0;
+    std::exception_ptr error;
+    bool stop = false;
+};
+
+} // namespace xu
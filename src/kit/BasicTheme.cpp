@@ -23,6 +23,7 @@
 #include "xu/core/Theme.hpp"
 #include <xu/kit/BasicTheme.hpp>
 #include <xu/kit/Button.hpp>
+#include <xu/core/Context.hpp>
 
 namespace xu {
 
@@ -47,8 +48,8 @@ void BasicTheme::InitializeWidget(
     Widget* widget, PaintInfo* info, PainterType basePainter) {
     if (basePainter == typeid(Button)) {
         Button* btn = static_cast<Button*>(widget);
-        info->paths = std::move(std::vector{
-            VectorPath::Rectangle(btn->Geometry().size).BakeFill(0.f)});
+        info->paths = {btn->GetContext().GetTessellationCache().BakeFill(
+            VectorPath::Rectangle(btn->Geometry().size), 0.f)};
     }
 }
 
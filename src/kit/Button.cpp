@@ -21,6 +21,7 @@
 // SOFTWARE.
 
 #include <xu/kit/Button.hpp>
+#include <xu/core/Context.hpp>
 #include <xu/core/Theme.hpp>
 
 namespace xu {
@@ -29,7 +30,8 @@ Button::Button(Widget* parent, Color inactive, Color hovered, Color clicked) :
     Widget{parent},
     slotHoverEnter{sigOnHoverEnter, this},
     slotHoverExit{sigOnHoverExit, this},
-    slotOnClick{sigOnClick, this} {
+    slotOnClick{sigOnClick, this},
+    slotOnRelease{sigOnRelease, this} {
     currentColor = inactive;
     inactiveColor = inactive;
     hoveredColor = hovered;
@@ -37,8 +39,8 @@ Button::Button(Widget* parent, Color inactive, Color hovered, Color clicked) :
 
     xu::VectorPath vpath
         = xu::VectorPath::RoundRectangle(xu::FSize2{100.0f, 100.0f}, 10.0f);
-    paintInfo.paths.push_back(
-        vpath.BakeStroke(50.f, 5.f, LineCap::Butt, LineJoin::Bevel));
+    paintInfo.paths.push_back(GetContext().GetTessellationCache().BakeStroke(
+        vpath, 50.f, 5.f, LineCap::Butt, LineJoin::Bevel));
 }
 
 FSize2 Button::SizeHint() const {
@@ -57,8 +59,15 @@ void Button::Paint(Surface& surf, Theme& theme) const {
 
 PainterType Button::Painter() { return typeid(Button); }
 
-void Button::OnHoverEnter() { currentColor = hoveredColor; }
-void Button::OnHoverExit() { currentColor = inactiveColor; }
-void Button::OnClick(CursorButton) { currentColor = clickedColor; }
+void Button::OnHoverEnter() { SetCurrentColor(hoveredColor); }
+void Button::OnHoverExit() { SetCurrentColor(inactiveColor); }
+void Button::OnClick(CursorButton) { SetCurrentColor(clickedColor); }
+void Button::OnRelease(CursorButton) { SetCurrentColor(hoveredColor); }
+
+void Button::SetCurrentColor(Color const& color) {
+    if (currentColor == color) { return; }
+    currentColor = color;
+    MarkDirty();
+}
 
 } // namespace xu
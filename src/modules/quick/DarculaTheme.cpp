@@ -23,6 +23,7 @@
 #include <xu/modules/quick/DarculaTheme.hpp>
 
 #include <xu/kit/Button.hpp>
+#include <xu/core/Context.hpp>
 
 namespace xu::quick {
 
@@ -49,18 +50,19 @@ void DarculaTheme::InitializeWidget(
     Widget* widget, PaintInfo* info, PainterType basePainter) {
     if (basePainter == typeid(Button)) {
         Button* btn = static_cast<Button*>(widget);
-        info->paths = std::move(std::vector{
-            VectorPath::RoundRectangle(btn->Geometry().size, CornerRadius)
-                .BakeStroke(50.f, 5.f, LineCap::Butt, LineJoin::Bevel)});
+        info->paths = {btn->GetContext().GetTessellationCache().BakeStroke(
+            VectorPath::RoundRectangle(btn->Geometry().size, CornerRadius),
+            50.f, 5.f, LineCap::Butt, LineJoin::Bevel)};
     }
 }
 
 void DarculaTheme::PaintWidget(Surface& surf, Widget const* widget,
     PaintInfo const* info, PainterType basePainter) {
     if (basePainter == typeid(Button)) {
+        PaintTransform transform;
+        transform.offset = widget->Geometry().origin;
         for (auto const& path : info->paths) {
-            surf.Paint(
-                path.WithOffset(widget->Geometry().origin), Color::White());
+            surf.Paint(path, Color::White(), transform);
         }
     }
 }
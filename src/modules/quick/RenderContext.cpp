@@ -39,6 +39,19 @@ void main() {
     gl_Position = vec4(invertY * 2.0f - 1.0f, 0, 1);
 })";
 
+constexpr const char* colorVtxShader =
+    R"(#version 430 core
+layout(location = 0) in vec2 iPos;
+layout(location = 1) in vec4 iColor;
+
+out vec4 vColor;
+
+void main() {
+    vec2 invertY = vec2(iPos.x, 1.0f - iPos.y);
+    gl_Position = vec4(invertY * 2.0f - 1.0f, 0, 1);
+    vColor = iColor;
+})";
+
 constexpr const char* fragShader = R"(
 #version 430 core
 
@@ -51,12 +64,25 @@ void main() {
 }
 )";
 
+constexpr const char* colorFragShader = R"(
+#version 430 core
+
+in vec4 vColor;
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = vColor;
+}
+)";
+
 RenderContext::RenderContext(LoadProc loadProc) {
     gladLoadGLLoader(loadProc);
 
     // Setup vertex buffers and VAO
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
+    glGenBuffers(1, &cbo);
     glGenBuffers(1, &ebo);
 
     glBindVertexArray(vao);
@@ -69,14 +95,23 @@ RenderContext::RenderContext(LoadProc loadProc) {
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
     glEnableVertexAttribArray(0);
 
+    // Only enabled while drawing render data that has per-vertex colors.
+    glBindBuffer(GL_ARRAY_BUFFER, cbo);
+    glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+        sizeof(xu::VertexColor), nullptr);
+
     shaderProgram = CreateShader(vtxShader, fragShader);
+    colorShaderProgram = CreateShader(colorVtxShader, colorFragShader);
 }
 
 RenderContext::~RenderContext() {
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &cbo);
     glDeleteBuffers(1, &ebo);
     glDeleteProgram(shaderProgram);
+    glDeleteProgram(colorShaderProgram);
 }
 
 // TODO: Track old GL state and restore after draw
@@ -84,7 +119,21 @@ void RenderContext::RenderDrawData(xu::RenderData const& renderData) {
     glClearColor(0, 0, 0, 1);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    glUseProgram(shaderProgram);
+    bool const perVertexColor
+        = renderData.vertexFormat == xu::VertexFormat::PositionColor;
+    glUseProgram(perVertexColor ? colorShaderProgram : shaderProgram);
+
+    glBindVertexArray(vao);
+
+    if (perVertexColor) {
+        glBindBuffer(GL_ARRAY_BUFFER, cbo);
+        glBufferData(GL_ARRAY_BUFFER,
+            renderData.colors.size() * sizeof(xu::VertexColor),
+            renderData.colors.data(), GL_DYNAMIC_DRAW);
+        glEnableVertexAttribArray(1);
+    } else {
+        glDisableVertexAttribArray(1);
+    }
 
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
@@ -92,11 +141,20 @@ void RenderContext::RenderDrawData(xu::RenderData const& renderData) {
     glBufferData(GL_ARRAY_BUFFER,
         renderData.vertices.size() * sizeof(xu::Vertex),
         renderData.vertices.data(), GL_DYNAMIC_DRAW);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-        renderData.indices.size() * sizeof(uint32_t), renderData.indices.data(),
-        GL_DYNAMIC_DRAW);
-
-    glBindVertexArray(vao);
+    bool const shortIndices
+        = renderData.indexFormat == xu::IndexFormat::UInt16;
+    if (shortIndices) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+            renderData.indices16.size() * sizeof(uint16_t),
+            renderData.indices16.data(), GL_DYNAMIC_DRAW);
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+            renderData.indices.size() * sizeof(uint32_t),
+            renderData.indices.data(), GL_DYNAMIC_DRAW);
+    }
+    GLenum const indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    std::size_t const indexSize
+        = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
 
     // Pretend we only have a single command list ( = single window) to
     // render, for now.
@@ -105,11 +163,12 @@ void RenderContext::RenderDrawData(xu::RenderData const& renderData) {
          ++it) {
         if (it->type == xu::DrawCommandType::DrawTriangles) {
             xu::CmdDrawTriangles const& cmd = it->data.drawTriangles;
-            auto color = cmd.color.Normalized();
-            glUniform4fv(0, 1, color.data());
-            glDrawElementsBaseVertex(GL_TRIANGLES, cmd.numIndices,
-                GL_UNSIGNED_INT, (void*)(cmd.indexOffset * sizeof(uint32_t)),
-                cmd.vertexOffset);
+            if (!perVertexColor) {
+                auto color = cmd.color.Normalized();
+                glUniform4fv(0, 1, color.data());
+            }
+            glDrawElementsBaseVertex(GL_TRIANGLES, cmd.numIndices, indexType,
+                (void*)(cmd.indexOffset * indexSize), cmd.vertexOffset);
         }
     }
 }
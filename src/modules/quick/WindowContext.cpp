@@ -30,11 +30,20 @@ static void MouseMoveCallback(GLFWwindow* window, double xpos, double ypos) {
     Context* ctx = reinterpret_cast<Context*>(glfwGetWindowUserPointer(window));
 
     CursorMoveEvent evt;
+    evt.id = static_cast<WindowID>(reinterpret_cast<uint64_t>(window));
     evt.position.x = xpos;
     evt.position.y = ypos;
     ctx->NotifyEvent(evt);
 }
 
+static void CursorEnterCallback(GLFWwindow* window, int entered) {
+    Context* ctx = reinterpret_cast<Context*>(glfwGetWindowUserPointer(window));
+    WindowCursorEnterEvent evt;
+    evt.id = static_cast<WindowID>(reinterpret_cast<uint64_t>(window));
+    evt.entered = entered;
+    ctx->NotifyEvent(evt);
+}
+
 static void MouseButtonCallback(
     GLFWwindow* window, int button, int state, int modifier) {
     Context* ctx = reinterpret_cast<Context*>(glfwGetWindowUserPointer(window));
@@ -83,6 +92,7 @@ WindowContext::NewWindowResult WindowContext::NewWindow(
     glfwMakeContextCurrent(win);
     glfwSetWindowSizeCallback(win, &WindowResizeCallback);
     glfwSetCursorPosCallback(win, &MouseMoveCallback);
+    glfwSetCursorEnterCallback(win, &CursorEnterCallback);
     glfwSetMouseButtonCallback(win, &MouseButtonCallback);
     windows.push_back(win);
     NewWindowResult result;
@@ -105,6 +115,8 @@ WindowID WindowContext::GetMainWindow() {
 
 void WindowContext::PollEvents() { glfwPollEvents(); }
 
+void WindowContext::WaitEvents() { glfwWaitEvents(); }
+
 bool WindowContext::ShouldClose(WindowID id) const {
     GLFWwindow* window
         = reinterpret_cast<GLFWwindow*>(static_cast<uint64_t>(id));
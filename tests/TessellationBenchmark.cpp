@@ -0,0 +1,189 @@
+// Compares the convex fan path of Triangulate() with ear clipping the same
+// polygons through earcut, which is what convex fills used before, and the
+// SSE2 kernels of FlattenPath() and ExpandPolyline() with the scalar ones.
+
+#include "xu/core/VectorPath.hpp"
+#include "Tessellation.hpp"
+
+#include <mapbox/earcut.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+template<typename Fn>
+double BestNanosecondsPerCall(Fn&& fn) {
+    constexpr int batches = 20;
+    constexpr int callsPerBatch = 2000;
+
+    double best = 1e30;
+    for (int batch = 0; batch < batches; ++batch) {
+        auto const start = std::chrono::steady_clock::now();
+        for (int call = 0; call < callsPerBatch; ++call) { fn(); }
+        auto const end = std::chrono::steady_clock::now();
+        best = std::min(best,
+            std::chrono::duration<double, std::nano>(end - start).count()
+                / callsPerBatch);
+    }
+    return best;
+}
+
+// VectorPath::Circle() is not implemented yet.
+xu::VectorPath Circle(float radius) {
+    xu::VectorPath path;
+    path.start = {2.f * radius, radius};
+    path.events.push_back(xu::VectorPathEvent::Arc(
+        {radius, radius}, radius, 0.f, 6.2831853f));
+    path.events.push_back(xu::VectorPathEvent::Close());
+    return path;
+}
+
+xu::VectorPath Triangle(float size) {
+    xu::VectorPath path;
+    path.start = {0.f, size};
+    path.events.push_back(xu::VectorPathEvent::Line({size / 2.f, 0.f}));
+    path.events.push_back(xu::VectorPathEvent::Line({size, size}));
+    path.events.push_back(xu::VectorPathEvent::Close());
+    return path;
+}
+
+void Benchmark(char const* name, xu::VectorPath const& path) {
+    std::vector<xu::FPoint2> const polygon = xu::FlattenPath(path, 1.0);
+
+    std::vector<uint32_t> indices;
+    double const fan = BestNanosecondsPerCall([&] {
+        indices.clear();
+        xu::Triangulate(polygon, indices);
+    });
+    std::size_t const fanIndices = indices.size();
+
+    std::vector<std::vector<std::array<float, 2>>> rings(1);
+    for (auto const& point : polygon) {
+        rings[0].push_back({point.x, point.y});
+    }
+    mapbox::detail::Earcut<uint32_t> earcut;
+    double const earClipping = BestNanosecondsPerCall([&] { earcut(rings); });
+
+    printf("%-24s %5zu points  fan %9.1f ns (%zu indices)  earcut %9.1f ns "
+           "(%zu indices)  %.1fx\n",
+        name, polygon.size(), fan, fanIndices, earClipping,
+        earcut.indices.size(), earClipping / fan);
+}
+
+// Random quadratics, cubics and arcs, i.e. everything that goes through the
+// batch kernels.
+xu::VectorPath Curves(std::mt19937& rng, int segments) {
+    std::uniform_real_distribution<float> coordinate(0.f, 1000.f);
+    std::uniform_real_distribution<float> radius(1.f, 500.f);
+    std::uniform_real_distribution<float> angle(-7.f, 7.f);
+    auto const point = [&] {
+        return xu::FPoint2{coordinate(rng), coordinate(rng)};
+    };
+
+    xu::VectorPath path;
+    path.start = point();
+    for (int i = 0; i < segments; ++i) {
+        path.events.push_back(xu::VectorPathEvent::Quadratic(point(), point()));
+        path.events.push_back(
+            xu::VectorPathEvent::Cubic(point(), point(), point()));
+        float const start = angle(rng);
+        path.events.push_back(xu::VectorPathEvent::Arc(
+            point(), radius(rng), start, start + angle(rng)));
+    }
+    return path;
+}
+
+struct KernelOutput {
+    std::vector<xu::FPoint2> points;
+    std::vector<xu::Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+KernelOutput RunKernels(xu::VectorPath const& path, double quality) {
+    KernelOutput output;
+    xu::FlattenPath(path, quality, output.points);
+    output.vertices.resize(2 * output.points.size());
+    output.indices.resize(6 * output.points.size());
+    xu::ExpandPolyline(output.points.data(), output.points.size(), 3.f, 4.f,
+        {0.01f, 0.02f}, {-1.f, 1.f}, output.vertices.data(),
+        output.indices.data(), 0);
+    return output;
+}
+
+bool SameBits(KernelOutput const& a, KernelOutput const& b) {
+    return a.points.size() == b.points.size()
+        && std::memcmp(a.points.data(), b.points.data(),
+               a.points.size() * sizeof(xu::FPoint2))
+        == 0
+        && std::memcmp(a.vertices.data(), b.vertices.data(),
+               a.vertices.size() * sizeof(xu::Vertex))
+        == 0
+        && a.indices == b.indices;
+}
+
+// The SSE2 kernels must produce exactly what the scalar ones do.
+bool TestSimdKernels() {
+    std::mt19937 rng(1);
+    for (int i = 0; i < 500; ++i) {
+        xu::VectorPath const path = Curves(rng, 4);
+        for (double quality : {0.5, 1.0, 4.0}) {
+            xu::SetSimdKernelsEnabled(false);
+            KernelOutput const scalar = RunKernels(path, quality);
+            xu::SetSimdKernelsEnabled(true);
+            if (!SameBits(scalar, RunKernels(path, quality))) {
+                printf("SIMD kernels differ from the scalar ones!\n");
+                return false;
+            }
+        }
+    }
+    printf("SIMD kernel test complete!\n");
+    return true;
+}
+
+void BenchmarkKernels(char const* name, xu::VectorPath const& path) {
+    std::vector<xu::FPoint2> points;
+    std::vector<xu::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    double flatten[2];
+    double expand[2];
+    for (bool simd : {false, true}) {
+        xu::SetSimdKernelsEnabled(simd);
+        flatten[simd] = BestNanosecondsPerCall([&] {
+            points.clear();
+            xu::FlattenPath(path, 1.0, points);
+        });
+        vertices.resize(2 * points.size());
+        indices.resize(6 * points.size());
+        expand[simd] = BestNanosecondsPerCall([&] {
+            xu::ExpandPolyline(points.data(), points.size(), 3.f, 4.f,
+                {1.f, 1.f}, {0.f, 0.f}, vertices.data(), indices.data(), 0);
+        });
+    }
+
+    printf("%-24s %5zu points  flatten %9.1f / %9.1f ns  expand %9.1f / "
+           "%9.1f ns (scalar / SSE2)\n",
+        name, points.size(), flatten[0], flatten[1], expand[0], expand[1]);
+}
+
+int main() {
+    if (!TestSimdKernels()) { return 1; }
+
+    Benchmark("triangle", Triangle(10.f));
+    Benchmark("rectangle", xu::VectorPath::Rectangle({100.f, 30.f}));
+    Benchmark("button", xu::VectorPath::RoundRectangle({100.f, 30.f}, 4.f));
+    Benchmark("panel", xu::VectorPath::RoundRectangle({800.f, 600.f}, 24.f));
+    Benchmark("small circle", Circle(8.f));
+    Benchmark("large circle", Circle(500.f));
+
+    if (xu::SimdKernelsAvailable()) {
+        std::mt19937 rng(2);
+        BenchmarkKernels("small circle", Circle(8.f));
+        BenchmarkKernels("large circle", Circle(500.f));
+        BenchmarkKernels("curves", Curves(rng, 16));
+    }
+    return 0;
+}
@@ -2,9 +2,12 @@
 #include "xu/core/Color.hpp"
 #include "xu/core/Context.hpp"
 #include "xu/core/Point2.hpp"
+#include "xu/core/RenderData.hpp"
 #include "xu/core/Vector2.hpp"
+#include "xu/core/WsiInterface.hpp"
 #include <assert.h>
 #include <initializer_list>
+#include <vector>
 #include <xu/core/Widget.hpp>
 #include <xu/core/Rect2.hpp>
 
@@ -142,12 +145,116 @@ void TestRect2() {
     printf("Rect test complete!\n");
 }
 
+void TestNarrowIndices() {
+    using xu::FVector2;
+
+    xu::RenderData renderData;
+    renderData.indexFormat = xu::IndexFormat::UInt16;
+    renderData.cmdLists.resize(1);
+
+    constexpr uint32_t numVertices = 70000;
+    std::vector<xu::Vertex> vertices(numVertices);
+    for (uint32_t i = 0; i < numVertices; ++i) {
+        vertices[i].position = FVector2(float(i), float(i % 7));
+    }
+    // Triangles spanning exactly 65536 vertices, one more, and a fan (like a
+    // large convex fill) that keeps spanning more past vertex 65535.
+    std::vector<uint32_t> indices = {0, 1, 65535, 0, 1, 65536};
+    for (uint32_t i = 1; i + 1 < numVertices; ++i) {
+        indices.insert(indices.end(), {0, i, i + 1});
+    }
+    renderData.PushGeometry(renderData.cmdLists[0], vertices, indices);
+
+    std::vector<FVector2> expected;
+    for (uint32_t index : indices) {
+        expected.push_back(vertices[index].position);
+    }
+
+    renderData.NarrowIndices();
+    assert(renderData.indices.empty());
+    assert(renderData.indices16.size() == indices.size());
+
+    std::vector<FVector2> narrowed;
+    auto const& cmdList = renderData.cmdLists[0];
+    for (auto it = cmdList.Begin(); it != cmdList.End(); ++it) {
+        auto const& cmd = it->data.drawTriangles;
+        for (size_t i = 0; i < cmd.numIndices; ++i) {
+            size_t const vertex
+                = cmd.vertexOffset + renderData.indices16[cmd.indexOffset + i];
+            assert(vertex < renderData.vertices.size());
+            narrowed.push_back(renderData.vertices[vertex].position);
+        }
+    }
+    assert(narrowed == expected);
+
+    // The triangle that still fits is drawn without copying vertices.
+    auto const& first = cmdList.Begin()->data.drawTriangles;
+    assert(first.vertexOffset == 0 && first.numIndices == 3);
+
+    printf("NarrowIndices test complete!\n");
+}
+
+class HeadlessWsi : public xu::WsiInterface {
+public:
+    NewWindowResult NewWindow(char const*, xu::ISize2 extent) override {
+        lastWindow = static_cast<xu::WindowID>(++numWindows);
+        return {lastWindow, {{0, 0}, extent}};
+    }
+    void DestroyWindow(xu::WindowID) override {}
+
+    uint64_t numWindows = 0;
+    xu::WindowID lastWindow{};
+};
+
+int firstHoverEnters = 0;
+int secondHoverEnters = 0;
+void OnFirstHoverEnter() { ++firstHoverEnters; }
+void OnSecondHoverEnter() { ++secondHoverEnters; }
+
+void TestCoalesceCursorMoves() {
+    xu::Context ctxt;
+    HeadlessWsi wsi;
+    ctxt.wsiInterface = &wsi;
+    ctxt.coalesceEvents = true;
+
+    xu::WindowID ids[2];
+    for (int i = 0; i < 2; ++i) {
+        auto root = ctxt.AddWindow("xu-test-window", {400, 300});
+        ids[i] = wsi.lastWindow;
+        auto btn = root->MakeChild<xu::Button>(xu::Color{255, 0, 0, 1.f},
+            xu::Color{0, 255, 0, 1.f}, xu::Color{0, 0, 255, 1.f});
+        btn->SetGeometry({{50, 50}, {100, 100}});
+        if (i == 0) {
+            btn->sigOnHoverEnter.Connect<&OnFirstHoverEnter>();
+        } else {
+            btn->sigOnHoverEnter.Connect<&OnSecondHoverEnter>();
+        }
+    }
+    ctxt.ProcessEvents();
+
+    // The cursor goes from the first window to the second and back within
+    // one frame; it must end up hovering the first window's button.
+    for (xu::WindowID id : {ids[0], ids[1], ids[0]}) {
+        xu::CursorMoveEvent move;
+        move.id = id;
+        move.position = {60, 60};
+        ctxt.NotifyEvent(move);
+    }
+    ctxt.ProcessEvents();
+    assert(firstHoverEnters == 1);
+    assert(secondHoverEnters == 0);
+
+    printf("Coalesce test complete!\n");
+}
+
 int main() {
     // CustomWidget pog;
 
     TestVector2();
     TestBounds2();
     TestRect2();
+    TestNarrowIndices();
+    TestCoalesceCursorMoves();
 
     xu::Context ctxt;
     ctxt.inputReception = xu::InputReception::Immediate;
@@ -163,11 +270,21 @@ int main() {
         xu::Color{0, 255, 0, 1.f}, xu::Color{0, 0, 255, 1.f});
     btn->SetGeometry({{50, 50}, btn->Geometry().size});
 
+    // Only poll right after drawing a frame; while nothing changes, sleep
+    // until the next event instead of spinning.
+    bool drewFrame = true;
     while (!winCtxt.ShouldClose(window)) {
-        winCtxt.PollEvents();
+        if (drewFrame) {
+            winCtxt.PollEvents();
+        } else {
+            winCtxt.WaitEvents();
+        }
         ctxt.ProcessEvents();
-        renderCtxt.RenderDrawData(ctxt.GetRenderData());
-        winCtxt.SwapBuffers(window);
+        drewFrame = ctxt.IsRenderDataDirty();
+        if (drewFrame) {
+            renderCtxt.RenderDrawData(ctxt.GetRenderData());
+            winCtxt.SwapBuffers(window);
+        }
     }
 
     return 0;